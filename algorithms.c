@@ -1,25 +1,502 @@
 #include "algorithms.h"
 
 #include <assert.h>
+#include <math.h>
+#include <pthread.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
 #define debug false
+
+/*
+ * Vectorized kernels for the array scans. SSE2 is always available on x86-64,
+ * AVX2 is selected at runtime when the CPU supports it.
+ */
+#if defined(__GNUC__) && defined(__x86_64__)
+#define ARRAY_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define ARRAY_SIMD_X86 0
+#endif
+
+static size_t array_search_scalar(const int *data, size_t i, size_t n, int value) {
+	for(; i < n; i++) {
+		if(data[i] == value) return i;
+	}
+	return n; // No match found
+}
+
+static bool array_equals_scalar(const int *a, const int *b, size_t i, size_t n) {
+	for(; i < n; i++) {
+		if(a[i] != b[i]) return false;
+	}
+	return true;
+}
+
+static bool array_is_sorted_scalar(const int *data, size_t i, size_t n) {
+	for(; i + 1 < n; i++) {
+		if(data[i] > data[i + 1]) return false;
+	}
+	return true;
+}
+
+#if ARRAY_SIMD_X86
+
+static size_t array_search_sse2(const int *data, size_t n, int value) {
+	__m128i needle = _mm_set1_epi32(value);
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8) {
+		__m128i a = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(data + i)), needle);
+		__m128i b = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(data + i + 4)), needle);
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(a)) | (_mm_movemask_ps(_mm_castsi128_ps(b)) << 4);
+		if(mask != 0) return i + __builtin_ctz(mask);
+	}
+	return array_search_scalar(data, i, n, value);
+}
+
+__attribute__((target("avx2")))
+static size_t array_search_avx2(const int *data, size_t n, int value) {
+	__m256i needle = _mm256_set1_epi32(value);
+	size_t i = 0;
+	for(; i + 16 <= n; i += 16) {
+		__m256i a = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(data + i)), needle);
+		__m256i b = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(data + i + 8)), needle);
+		int mask = _mm256_movemask_ps(_mm256_castsi256_ps(a)) | (_mm256_movemask_ps(_mm256_castsi256_ps(b)) << 8);
+		if(mask != 0) return i + __builtin_ctz(mask);
+	}
+	return array_search_scalar(data, i, n, value);
+}
+
+static bool array_equals_sse2(const int *x, const int *y, size_t n) {
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8) {
+		__m128i a = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(x + i)), _mm_loadu_si128((const __m128i *)(y + i)));
+		__m128i b = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(x + i + 4)), _mm_loadu_si128((const __m128i *)(y + i + 4)));
+		if(_mm_movemask_epi8(_mm_and_si128(a, b)) != 0xFFFF) return false;
+	}
+	return array_equals_scalar(x, y, i, n);
+}
+
+__attribute__((target("avx2")))
+static bool array_equals_avx2(const int *x, const int *y, size_t n) {
+	size_t i = 0;
+	for(; i + 16 <= n; i += 16) {
+		__m256i a = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(x + i)), _mm256_loadu_si256((const __m256i *)(y + i)));
+		__m256i b = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(x + i + 8)), _mm256_loadu_si256((const __m256i *)(y + i + 8)));
+		if(_mm256_movemask_epi8(_mm256_and_si256(a, b)) != -1) return false;
+	}
+	return array_equals_scalar(x, y, i, n);
+}
+
+/*
+ * Compare each block with the same block shifted by one element: the array is
+ * sorted if no element is greater than its successor
+ */
+static bool array_is_sorted_sse2(const int *data, size_t n) {
+	size_t i = 0;
+	for(; i + 9 <= n; i += 8) {
+		__m128i a = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *)(data + i)), _mm_loadu_si128((const __m128i *)(data + i + 1)));
+		__m128i b = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *)(data + i + 4)), _mm_loadu_si128((const __m128i *)(data + i + 5)));
+		if(_mm_movemask_epi8(_mm_or_si128(a, b)) != 0) return false;
+	}
+	return array_is_sorted_scalar(data, i, n);
+}
+
+__attribute__((target("avx2")))
+static bool array_is_sorted_avx2(const int *data, size_t n) {
+	size_t i = 0;
+	for(; i + 17 <= n; i += 16) {
+		__m256i a = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i *)(data + i)), _mm256_loadu_si256((const __m256i *)(data + i + 1)));
+		__m256i b = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i *)(data + i + 8)), _mm256_loadu_si256((const __m256i *)(data + i + 9)));
+		if(_mm256_movemask_epi8(_mm256_or_si256(a, b)) != 0) return false;
+	}
+	return array_is_sorted_scalar(data, i, n);
+}
+
+static bool array_has_avx2(void) {
+	return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+static enum array_simd array_simd_forced = ARRAY_SIMD_AUTO;
+
+void array_set_simd(enum array_simd level) {
+	array_simd_forced = level;
+}
+
+/*
+ * The kernel level to use, the forced one if the CPU supports it
+ */
+static enum array_simd array_simd_level(void) {
+#if ARRAY_SIMD_X86
+	enum array_simd best = array_has_avx2() ? ARRAY_SIMD_AVX2 : ARRAY_SIMD_SSE2;
+	if(array_simd_forced == ARRAY_SIMD_AUTO || array_simd_forced > best) return best;
+	return array_simd_forced;
+#else
+	return ARRAY_SIMD_SCALAR;
+#endif
+}
+/*
+ * The system allocator
+ */
+static void *system_allocate(void *ctx, size_t size) {
+	(void) ctx;
+	return malloc(size);
+}
+
+static void *system_reallocate(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+	(void) ctx;
+	(void) old_size;
+	return realloc(ptr, new_size);
+}
+
+static void system_deallocate(void *ctx, void *ptr, size_t size) {
+	(void) ctx;
+	(void) size;
+	free(ptr);
+}
+
+const struct allocator allocator_system = { system_allocate, system_reallocate, system_deallocate, NULL };
+
+static const struct allocator *default_allocator = &allocator_system;
+
+/*
+ * Set the allocator used by the containers created without one (NULL for allocator_system)
+ */
+void allocator_set_default(const struct allocator *allocator) {
+	default_allocator = allocator != NULL ? allocator : &allocator_system;
+}
+
+/*
+ * Get the allocator used by the containers created without one
+ */
+const struct allocator *allocator_get_default(void) {
+	return default_allocator;
+}
+
+/*
+ * The arena allocator
+ */
+#define ARENA_ALIGNMENT 16
+#define ARENA_ROUND(size) (((size) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+struct arena_chunk {
+	struct arena_chunk *next;
+	size_t size;
+	size_t used;
+};
+
+// The blocks of a chunk start right after its (aligned) header
+#define ARENA_HEADER ARENA_ROUND(sizeof(struct arena_chunk))
+
+static char *arena_chunk_data(struct arena_chunk *chunk) {
+	return (char *) chunk + ARENA_HEADER;
+}
+
+static void *arena_allocate(void *ctx, size_t size) {
+	struct arena *self = ctx;
+	size = ARENA_ROUND(size);
+	struct arena_chunk *chunk = self->chunks;
+	if(chunk == NULL || chunk->size - chunk->used < size) {
+		// A new chunk in front of the others, big enough for this block
+		size_t chunkSize = size > self->chunk_size ? size : self->chunk_size;
+		chunk = malloc(ARENA_HEADER + chunkSize);
+		if(chunk == NULL) return NULL;
+		chunk->next = self->chunks;
+		chunk->size = chunkSize;
+		chunk->used = 0;
+		self->chunks = chunk;
+	}
+	void *ptr = arena_chunk_data(chunk) + chunk->used;
+	chunk->used += size;
+	self->last = ptr;
+	return ptr;
+}
+
+static void *arena_reallocate(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+	struct arena *self = ctx;
+	if(ptr == NULL) return arena_allocate(ctx, new_size);
+	// The last block can grow or shrink in place
+	struct arena_chunk *chunk = self->chunks;
+	if(ptr == self->last && chunk->used - ARENA_ROUND(old_size) + ARENA_ROUND(new_size) <= chunk->size) {
+		chunk->used = chunk->used - ARENA_ROUND(old_size) + ARENA_ROUND(new_size);
+		return ptr;
+	}
+	void *newPtr = arena_allocate(ctx, new_size);
+	if(newPtr == NULL) return NULL;
+	memcpy(newPtr, ptr, old_size < new_size ? old_size : new_size);
+	return newPtr;
+}
+
+static void arena_deallocate(void *ctx, void *ptr, size_t size) {
+	struct arena *self = ctx;
+	// Only the last block can be given back, the others wait for arena_reset
+	if(ptr != NULL && ptr == self->last) {
+		self->chunks->used -= ARENA_ROUND(size);
+		self->last = NULL;
+	}
+}
+
+/*
+ * Create an empty arena that allocates chunks of chunk_size bytes
+ */
+void arena_create(struct arena *self, size_t chunk_size) {
+	self->chunks = NULL;
+	self->chunk_size = chunk_size > 0 ? ARENA_ROUND(chunk_size) : ARENA_ALIGNMENT;
+	self->last = NULL;
+}
+
+/*
+ * Destroy an arena and all the memory allocated from it
+ */
+void arena_destroy(struct arena *self) {
+	struct arena_chunk *chunk = self->chunks;
+	while(chunk != NULL) {
+		struct arena_chunk *next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+	self->chunks = NULL;
+	self->last = NULL;
+}
+
+/*
+ * Give back all the memory allocated from the arena at once
+ */
+void arena_reset(struct arena *self) {
+	// We keep one regular chunk so that the next allocations do not call malloc
+	struct arena_chunk *kept = NULL;
+	struct arena_chunk *chunk = self->chunks;
+	while(chunk != NULL) {
+		struct arena_chunk *next = chunk->next;
+		if(kept == NULL && chunk->size == self->chunk_size) {
+			kept = chunk;
+		} else {
+			free(chunk);
+		}
+		chunk = next;
+	}
+	if(kept != NULL) {
+		kept->next = NULL;
+		kept->used = 0;
+	}
+	self->chunks = kept;
+	self->last = NULL;
+}
+
+/*
+ * Get an allocator that allocates from the arena
+ */
+void arena_allocator(struct arena *self, struct allocator *allocator) {
+	allocator->allocate = arena_allocate;
+	allocator->reallocate = arena_reallocate;
+	allocator->deallocate = arena_deallocate;
+	allocator->ctx = self;
+}
+
+/*
+ * The thread cache allocator: blocks up to THREAD_CACHE_MAX_SIZE bytes are
+ * rounded to a size class and, when freed, kept in a list of the current
+ * thread for the next allocation of the same class
+ */
+#define THREAD_CACHE_GRANULARITY 16
+#define THREAD_CACHE_CLASSES 16
+#define THREAD_CACHE_MAX_SIZE (THREAD_CACHE_GRANULARITY * THREAD_CACHE_CLASSES)
+#define THREAD_CACHE_LIMIT 256
+
+struct thread_cache_block {
+	struct thread_cache_block *next;
+};
+
+struct thread_cache {
+	struct thread_cache_block *blocks[THREAD_CACHE_CLASSES];
+	size_t counts[THREAD_CACHE_CLASSES];
+};
+
+static pthread_key_t thread_cache_key;
+static pthread_once_t thread_cache_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Called when a thread exits
+ */
+static void thread_cache_release(void *ptr) {
+	struct thread_cache *cache = ptr;
+	for(size_t c = 0; c < THREAD_CACHE_CLASSES; c++) {
+		struct thread_cache_block *block = cache->blocks[c];
+		while(block != NULL) {
+			struct thread_cache_block *next = block->next;
+			free(block);
+			block = next;
+		}
+	}
+	free(cache);
+}
+
+static void thread_cache_init(void) {
+	pthread_key_create(&thread_cache_key, thread_cache_release);
+}
+
+static struct thread_cache *thread_cache_get(void) {
+	pthread_once(&thread_cache_once, thread_cache_init);
+	struct thread_cache *cache = pthread_getspecific(thread_cache_key);
+	if(cache == NULL) {
+		cache = calloc(1, sizeof(struct thread_cache));
+		if(cache != NULL && pthread_setspecific(thread_cache_key, cache) != 0) {
+			free(cache);
+			cache = NULL;
+		}
+	}
+	return cache;
+}
+
+static size_t thread_cache_class(size_t size) {
+	return size == 0 ? 0 : (size - 1) / THREAD_CACHE_GRANULARITY;
+}
+
+static void *thread_cache_allocate(void *ctx, size_t size) {
+	(void) ctx;
+	if(size > THREAD_CACHE_MAX_SIZE) return malloc(size);
+	size_t c = thread_cache_class(size);
+	struct thread_cache *cache = thread_cache_get();
+	if(cache != NULL && cache->blocks[c] != NULL) {
+		struct thread_cache_block *block = cache->blocks[c];
+		cache->blocks[c] = block->next;
+		cache->counts[c]--;
+		return block;
+	}
+	return malloc((c + 1) * THREAD_CACHE_GRANULARITY);
+}
+
+static void thread_cache_deallocate(void *ctx, void *ptr, size_t size) {
+	(void) ctx;
+	if(ptr == NULL) return;
+	if(size <= THREAD_CACHE_MAX_SIZE) {
+		size_t c = thread_cache_class(size);
+		struct thread_cache *cache = thread_cache_get();
+		if(cache != NULL && cache->counts[c] < THREAD_CACHE_LIMIT) {
+			struct thread_cache_block *block = ptr;
+			block->next = cache->blocks[c];
+			cache->blocks[c] = block;
+			cache->counts[c]++;
+			return;
+		}
+	}
+	free(ptr);
+}
+
+static void *thread_cache_reallocate(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+	if(ptr == NULL) return thread_cache_allocate(ctx, new_size);
+	if(old_size > THREAD_CACHE_MAX_SIZE && new_size > THREAD_CACHE_MAX_SIZE) return realloc(ptr, new_size);
+	// Same size class, the block is already big enough
+	if(old_size <= THREAD_CACHE_MAX_SIZE && new_size <= THREAD_CACHE_MAX_SIZE
+			&& thread_cache_class(old_size) == thread_cache_class(new_size)) return ptr;
+	void *newPtr = thread_cache_allocate(ctx, new_size);
+	if(newPtr == NULL) return NULL;
+	memcpy(newPtr, ptr, old_size < new_size ? old_size : new_size);
+	thread_cache_deallocate(ctx, ptr, old_size);
+	return newPtr;
+}
+
+const struct allocator allocator_thread_cache = { thread_cache_allocate, thread_cache_reallocate, thread_cache_deallocate, NULL };
+
+/*
+ * Change the capacity of the array to exactly capacity elements
+ */
+static bool array_realloc(struct array *self, size_t capacity) {
+	const struct allocator *allocator = self->allocator;
+	// Small enough for the inline buffer, we give the heap buffer back
+	if(capacity <= ARRAY_SMALL_CAPACITY) {
+		if(self->data != self->inline_data) {
+			if(self->size > 0) memcpy(self->inline_data, self->data, self->size * sizeof(int));
+			allocator->deallocate(allocator->ctx, self->data, self->capacity * sizeof(int));
+			self->data = self->inline_data;
+		}
+		self->capacity = ARRAY_SMALL_CAPACITY;
+		return true;
+	}
+	int *newData;
+	if(self->data == self->inline_data) {
+		// Spill from the inline buffer to the heap
+		newData = allocator->allocate(allocator->ctx, capacity * sizeof(int));
+		if(newData != NULL) memcpy(newData, self->inline_data, self->size * sizeof(int));
+	} else {
+		newData = allocator->reallocate(allocator->ctx, self->data, self->capacity * sizeof(int), capacity * sizeof(int));
+	}
+	if(newData == NULL) {
+		printf("Problem with memory allocation in array_realloc\n");
+		return false;
+	}
+	self->data = newData;
+	self->capacity = capacity;
+	return true;
+}
+
+/*
+ * Make room for at least needed elements, growing geometrically so that
+ * a sequence of insertions costs amortized O(1) per element
+ */
+static bool array_grow(struct array *self, size_t needed) {
+	if(needed <= self->capacity) return true;
+	size_t maxCapacity = SIZE_MAX / sizeof(int);
+	if(needed > maxCapacity) {
+		printf("Problem with memory allocation in array_grow\n");
+		return false;
+	}
+	// Clamped before the conversion, a double too big for size_t is undefined behavior
+	double grown = (double)self->capacity * self->growth_factor;
+	size_t newCapacity = grown >= (double)maxCapacity ? maxCapacity : (size_t)grown;
+	if(newCapacity <= self->capacity) newCapacity = self->capacity + 1;
+	if(newCapacity < needed) newCapacity = needed;
+	return array_realloc(self, newCapacity);
+}
+
+/*
+ * Give memory back once the array is only a quarter full. We only halve the
+ * capacity so that alternating push and pop around the threshold does not
+ * trigger a reallocation each time (hysteresis)
+ */
+static void array_auto_shrink(struct array *self) {
+	if(self->capacity <= ARRAY_INITIAL_CAPACITY || self->size > self->capacity / 4)
+		return;
+	size_t newCapacity = self->capacity / 2;
+	if(newCapacity < ARRAY_INITIAL_CAPACITY) newCapacity = ARRAY_INITIAL_CAPACITY;
+	array_realloc(self, newCapacity); // On failure we simply keep the bigger buffer
+}
+
+/*
+ * Make self a fixed view on size elements of data, it must not be destroyed
+ */
+static void array_view(struct array *self, int *data, size_t size) {
+	self->data = data;
+	self->size = size;
+	self->capacity = size;
+	self->growth_factor = ARRAY_DEFAULT_GROWTH_FACTOR;
+	self->heap_arity = ARRAY_DEFAULT_HEAP_ARITY;
+	self->allocator = &allocator_system;
+}
+
 /*
  * Create an empty array
  */
 void array_create(struct array *self) {
-	self->data = (int *) malloc(20 * sizeof(int));
-	// We check for errors with malloc
-	if(self->data == NULL) {
-		printf("Error with memory allocation !");
-		return;
-	}
+	array_create_with(self, allocator_get_default());
+}
 
-	self->capacity = 20;
+/*
+ * Create an empty array that gets its memory from allocator
+ */
+void array_create_with(struct array *self, const struct allocator *allocator) {
 	self->size = 0;
+	self->growth_factor = ARRAY_DEFAULT_GROWTH_FACTOR;
+	self->heap_arity = ARRAY_DEFAULT_HEAP_ARITY;
+	self->allocator = allocator;
+	// Small arrays live in the inline buffer, no allocation needed
+	self->data = self->inline_data;
+	self->capacity = ARRAY_SMALL_CAPACITY;
 }
 
 /*
@@ -27,17 +504,9 @@ void array_create(struct array *self) {
  */
 void array_create_from(struct array *self, const int *other, size_t size) {
 	array_create(self); // We create an empty array
-	// We check if there has been an error with the previous function
-	if(self->data == NULL) {
-		printf("Error with memory allocation on array_create_from !");
-		return;
-	}
 	// If there is not enough space in the newly created array we need to realloc more space
-	if(size > self->capacity) {
-		int *newData = realloc(self->data, size * sizeof(int));
-		self->data = newData;
-		self->capacity = size;	
-	}
+	if(size > self->capacity && !array_realloc(self, size))
+		return;
 
 	self->size = size;
 	// We put the data inside the new array
@@ -51,7 +520,8 @@ void array_create_from(struct array *self, const int *other, size_t size) {
  */
 void array_destroy(struct array *self) {
 	if(self->data != NULL){
-		free(self->data);
+		if(self->data != self->inline_data)
+			self->allocator->deallocate(self->allocator->ctx, self->data, self->capacity * sizeof(int));
 		self->data = NULL;
 	}
 	// Set the values to 0 (not necessary)
@@ -59,6 +529,34 @@ void array_destroy(struct array *self) {
 	self->size = 0;
 }
 
+/*
+ * Set the factor used to grow the capacity of the array (must be finite and greater than 1)
+ */
+void array_set_growth_factor(struct array *self, double factor) {
+	if(!isfinite(factor) || factor <= 1.0) {
+		if(debug) printf("Growth factor must be greater than 1 in array_set_growth_factor\n");
+		return;
+	}
+	self->growth_factor = factor;
+}
+
+/*
+ * Make sure the array can hold at least capacity elements without reallocation
+ */
+void array_reserve(struct array *self, size_t capacity) {
+	if(capacity <= self->capacity) return;
+	array_realloc(self, capacity);
+}
+
+/*
+ * Reduce the capacity of the array to its size, but not below ARRAY_SMALL_CAPACITY
+ * (the inline buffer is always there)
+ */
+void array_shrink_to_fit(struct array *self) {
+	if(self->capacity == self->size) return;
+	array_realloc(self, self->size);
+}
+
 /*
  * Tell if the array is empty
  */
@@ -79,30 +577,27 @@ bool array_equals(const struct array *self, const int *content, size_t size) {
 	// We look if the array and content don't have a matching size
 	if(self->size != size)
 		return false;
-	for(int i = 0; i < (int)size; i++) {
-		if(self->data[i] != content[i])	
-			return false;
+	switch(array_simd_level()) {
+#if ARRAY_SIMD_X86
+	case ARRAY_SIMD_AVX2: return array_equals_avx2(self->data, content, size);
+	case ARRAY_SIMD_SSE2: return array_equals_sse2(self->data, content, size);
+#endif
+	default: return array_equals_scalar(self->data, content, 0, size);
 	}
-  return true;
 }
 
 /*
  * Add an element at the end of the array
  */
 void array_push_back(struct array *self, int value) {
-    // We treat the case where the array has NOT enough capacity
-	if (self->size>= self->capacity) {
-		int *newData = (int *) realloc(self->data, (self->capacity + 1) * sizeof(int));
-		if(newData == NULL) {
-			printf("Problem with memory allocation in array_push_back\n");
-			return;
-		}
-		self->capacity++;
-		self->data = newData;
+	// We treat the case where the array has NOT enough capacity
+	if(!array_grow(self, self->size + 1)) {
+		printf("Problem with memory allocation in array_push_back\n");
+		return;
 	}
 
-    self->data[self->size] = value;
-    self->size++;
+	self->data[self->size] = value;
+	self->size++;
 }
 
 /*
@@ -112,6 +607,7 @@ void array_pop_back(struct array *self) {
 	// In the case there is nothing to pop
 	if(self->size <= 0) return;
 	self->size--;
+	array_auto_shrink(self);
 }
 
 
@@ -119,23 +615,7 @@ void array_pop_back(struct array *self) {
  * Insert an element in the array (preserving the order)
  */
 void array_insert(struct array *self, int value, size_t index) {
-	// We realloc if there is not enough space
-	if(self->capacity > self->size + 1) {
-		int *newData = (int *) realloc(self->data, (self->capacity + 1) * sizeof(int));
-		if(newData == NULL) {
-			printf("Problem with memory allocation is array_insert\n");
-			return;
-		}
-		
-		self->data = newData;
-		self->capacity++;
-	}
-	self->size++; // Because we are going to add an element
-	// We shift each element that are after our index (included) to the right
-	for(int i = (int)self->size;i > (int)index; i--) {
-		self->data[i] = self->data[i - 1];
-	}
-	self->data[index] = value;
+	array_insert_range(self, &value, 1, index);
 }
 
 
@@ -143,16 +623,59 @@ void array_insert(struct array *self, int value, size_t index) {
  * Remove an element in the array (preserving the order)
  */
 void array_remove(struct array *self, size_t index) {
+	array_remove_range(self, index, 1);
+}
+
+/*
+ * Replace the content of the array with size elements from other
+ */
+void array_assign(struct array *self, const int *other, size_t size) {
+	self->size = 0;
+	array_append_range(self, other, size);
+}
+
+/*
+ * Add size elements from other at the end of the array
+ */
+void array_append_range(struct array *self, const int *other, size_t size) {
+	array_insert_range(self, other, size, self->size);
+}
+
+/*
+ * Insert size elements from other in the array at index (preserving the order)
+ */
+void array_insert_range(struct array *self, const int *other, size_t size, size_t index) {
 	// Looking for out of bounds
-	if (index >= self->size) {
-		if(debug) printf("Index out of bounds on array_remove\n");
+	if(index > self->size) {
+		if(debug) printf("Index out of bounds on array_insert_range\n");
 		return;
 	}
-	// Move every element to the right starting at index meaning it will be deleted
-	for(int i = index; i < (int)self->size; i++) {
-		self->data[i] = self->data[i + 1];
+	if(size == 0) return;
+	// We realloc at most once if there is not enough space
+	if(!array_grow(self, self->size + size)) {
+		printf("Problem with memory allocation is array_insert_range\n");
+		return;
 	}
-	self->size--;
+	// We shift the whole tail to the right in one move, then copy the block
+	memmove(self->data + index + size, self->data + index, (self->size - index) * sizeof(int));
+	memcpy(self->data + index, other, size * sizeof(int));
+	self->size += size;
+}
+
+/*
+ * Remove count elements from the array starting at index (preserving the order)
+ */
+void array_remove_range(struct array *self, size_t index, size_t count) {
+	// Looking for out of bounds
+	if(index >= self->size || count > self->size - index) {
+		if(debug) printf("Index out of bounds on array_remove_range\n");
+		return;
+	}
+	if(count == 0) return;
+	// Move the tail to the left in one move, meaning the range will be deleted
+	memmove(self->data + index, self->data + index + count, (self->size - index - count) * sizeof(int));
+	self->size -= count;
+	array_auto_shrink(self);
 }
 
 /*
@@ -183,10 +706,13 @@ void array_set(struct array *self, size_t index, int value) {
  * Search for an element in the array.
  */
 size_t array_search(const struct array *self, int value) {
-	for(int i = 0; i < (int)self->size; i++) {
-		if (self->data[i] == value) return i;
+	switch(array_simd_level()) {
+#if ARRAY_SIMD_X86
+	case ARRAY_SIMD_AVX2: return array_search_avx2(self->data, self->size, value);
+	case ARRAY_SIMD_SSE2: return array_search_sse2(self->data, self->size, value);
+#endif
+	default: return array_search_scalar(self->data, 0, self->size, value);
 	}
-  	return self->size; // No match found
 }
 
 /*
@@ -206,14 +732,63 @@ size_t array_search_sorted(const struct array *self, int value) {
 	return self->size; // No match Found
 }
 
+/*
+ * Number of binary searches advanced together by array_search_sorted_batch
+ */
+#define SEARCH_BATCH_GROUP 16
+
+/*
+ * Search for n keys in the sorted array, out[i] receives the same result as array_search_sorted(self, keys[i])
+ */
+void array_search_sorted_batch(const struct array *self, const int *keys, size_t n, size_t *out) {
+	size_t left[SEARCH_BATCH_GROUP];
+	size_t right[SEARCH_BATCH_GROUP];
+
+	for(size_t base = 0; base < n; base += SEARCH_BATCH_GROUP) {
+		size_t count = n - base < SEARCH_BATCH_GROUP ? n - base : SEARCH_BATCH_GROUP;
+		size_t active = 0;
+		for(size_t j = 0; j < count; j++) {
+			left[j] = 0;
+			right[j] = self->size;
+			out[base + j] = self->size; // No match found (yet)
+			if(left[j] < right[j]) active++;
+		}
+
+		while(active > 0) {
+			// First ask for the next probe of every search, so the cache misses overlap...
+#ifdef __GNUC__
+			for(size_t j = 0; j < count; j++) {
+				if(left[j] < right[j]) __builtin_prefetch(self->data + left[j] + (right[j] - left[j]) / 2);
+			}
+#endif
+			// ...then do one step of every search, with the same probes as array_search_sorted
+			for(size_t j = 0; j < count; j++) {
+				if(left[j] >= right[j]) continue;
+				size_t mid = left[j] + (right[j] - left[j]) / 2;
+				int value = keys[base + j];
+				if(self->data[mid] == value) {
+					out[base + j] = mid; // Match found
+					right[j] = left[j];
+				}
+				else if(self->data[mid] < value) left[j] = mid + 1;
+				else right[j] = mid;
+				if(left[j] >= right[j]) active--;
+			}
+		}
+	}
+}
+
 /*
  * Tell if the array is sorted
  */
 bool array_is_sorted(const struct array *self) {
-	for(int i = 0; i < (int)self->size - 1; i++) {
-		if(self->data[i] > self->data[i + 1]) return false;
+	switch(array_simd_level()) {
+#if ARRAY_SIMD_X86
+	case ARRAY_SIMD_AVX2: return array_is_sorted_avx2(self->data, self->size);
+	case ARRAY_SIMD_SSE2: return array_is_sorted_sse2(self->data, self->size);
+#endif
+	default: return array_is_sorted_scalar(self->data, 0, self->size);
 	}
-	return true;
 }
 
 /*
@@ -221,468 +796,2102 @@ bool array_is_sorted(const struct array *self) {
  */
 ptrdiff_t array_partition(struct array *self, ptrdiff_t i, ptrdiff_t j) {
 	// We choose the pivot (the first value stored in the array)
-	ptrdiff_t pivotIndex = i;
-	ptrdiff_t left = i;
+	int pivot = self->data[i];
+	ptrdiff_t left = i + 1;
 	ptrdiff_t right = j;
 	int temp;
-	while(left <= right) {
-		while(left <= right && self->data[left] <= self->data[pivotIndex]) {
+	for(;;) {
+		// We stop on values equal to the pivot so that duplicates end up on both sides
+		while(left <= right && self->data[left] < pivot) {
 			left++;
 		}
-		while(left <= right && self->data[right] >= self->data[pivotIndex]) {
+		while(left <= right && self->data[right] > pivot) {
 			right--;
 		}
-		if(left <= right) {
-			// We need to swap the values of left and right
-			temp = self->data[left];
-			self->data[left] = self->data[right];
-			self->data[right] = temp;
-		}
+		if(left >= right) break;
+		// We need to swap the values of left and right
+		temp = self->data[left];
+		self->data[left] = self->data[right];
+		self->data[right] = temp;
+		left++;
+		right--;
 	}
 	// Swap the value that is stored in right with the position of the pivot
-	temp = self->data[pivotIndex];
-	self->data[pivotIndex] = self->data[right];
-	self->data[right] = temp;
+	self->data[i] = self->data[right];
+	self->data[right] = pivot;
 	return right;
 }
 
-void quick_sort_reccu(struct array *self, ptrdiff_t low, ptrdiff_t high) {
-	if(low < high) {
-		ptrdiff_t pivotIndex = array_partition(self, low, high); // Paritions the array and get the index of the pivot
-		quick_sort_reccu(self, low, pivotIndex - 1);
-		quick_sort_reccu(self, pivotIndex + 1, high);
+/*
+ * Under this size, insertion sort is faster than partitioning
+ */
+#define ARRAY_INSERTION_SORT_THRESHOLD 16
+
+/*
+ * Over this size, the pivot is the ninther (median of three medians of three)
+ */
+#define ARRAY_NINTHER_THRESHOLD 128
+
+static void array_insertion_sort_range(int *data, ptrdiff_t low, ptrdiff_t high) {
+	for(ptrdiff_t i = low + 1; i <= high; i++) {
+		int value = data[i];
+		ptrdiff_t j = i;
+		while(j > low && data[j - 1] > value) {
+			data[j] = data[j - 1];
+			j--;
+		}
+		data[j] = value;
 	}
 }
 
 /*
- * Sort the array with quick sort
+ * Get the index of the median of the values at a, b and c
  */
-void array_quick_sort(struct array *self) {
-	if(self->size <= 1) return; // Nothing to sort
-	quick_sort_reccu(self, 0, self->size - 1);
-	
+static ptrdiff_t array_median_of_three(const int *data, ptrdiff_t a, ptrdiff_t b, ptrdiff_t c) {
+	if(data[a] < data[b]) {
+		if(data[b] < data[c]) return b;
+		return data[a] < data[c] ? c : a;
+	}
+	if(data[a] < data[c]) return a;
+	return data[b] < data[c] ? c : b;
 }
 
-static void heapify(struct array *self, size_t n, size_t i) {
-    size_t largest = i;
-    size_t left = 2 * i + 1;
-    size_t right = 2 * i + 2;
-
-    if (left < n && self->data[left] > self->data[largest]) {
-        largest = left;
-    }
-
-    if (right < n && self->data[right] > self->data[largest]) {
-        largest = right;
-    }
-
-    if (largest != i) {
-        int temp = self->data[i];
-        self->data[i] = self->data[largest];
-        self->data[largest] = temp;
-
-        heapify(self, n, largest);
-    }
+static ptrdiff_t array_choose_pivot(const int *data, ptrdiff_t low, ptrdiff_t high) {
+	ptrdiff_t mid = low + (high - low) / 2;
+	if(high - low + 1 < ARRAY_NINTHER_THRESHOLD) {
+		return array_median_of_three(data, low, mid, high);
+	}
+	ptrdiff_t step = (high - low + 1) / 8;
+	ptrdiff_t a = array_median_of_three(data, low, low + step, low + 2 * step);
+	ptrdiff_t b = array_median_of_three(data, mid - step, mid, mid + step);
+	ptrdiff_t c = array_median_of_three(data, high - 2 * step, high - step, high);
+	return array_median_of_three(data, a, b, c);
 }
-/*
- * Sort the array with heap sort
- * */
-void array_heap_sort(struct array *self) {
-    // Build max heap
-    for (int i = self->size / 2 - 1; i >= 0; --i) {
-        heapify(self, self->size, i);
-    }
 
-    // Extract elements from the heap one by one
-    for (int i = self->size - 1; i > 0; --i) {
-        // Swap the root (maximum element) with the last element
-        int temp = self->data[0];
-        self->data[0] = self->data[i];
-        self->data[i] = temp;
-
-        // Call heapify on the reduced heap
-        heapify(self, i, 0);
-    }
-}
+static void heap_sort_range(int *data, size_t n);
 
 /*
- * Tell if the array is a heap
+ * Introsort: quick sort that recurses only on the smaller side (so the stack
+ * depth is O(log n)) and switches to heap sort when the partitions are too
+ * unbalanced (so the time is O(n log n))
  */
-bool array_is_heap(const struct array *self) {
-	if(self == NULL || self->size < 1) return true;
+static void introsort_reccu(struct array *self, ptrdiff_t low, ptrdiff_t high, size_t depthLimit) {
+	while(high - low + 1 > ARRAY_INSERTION_SORT_THRESHOLD) {
+		if(depthLimit == 0) {
+			heap_sort_range(self->data + low, (size_t)(high - low + 1));
+			return;
+		}
+		depthLimit--;
+
+		// Move the chosen pivot at the beginning, where array_partition expects it
+		ptrdiff_t pivotIndex = array_choose_pivot(self->data, low, high);
+		int temp = self->data[low];
+		self->data[low] = self->data[pivotIndex];
+		self->data[pivotIndex] = temp;
+
+		pivotIndex = array_partition(self, low, high);
+		if(pivotIndex - low < high - pivotIndex) {
+			introsort_reccu(self, low, pivotIndex - 1, depthLimit);
+			low = pivotIndex + 1;
+		} else {
+			introsort_reccu(self, pivotIndex + 1, high, depthLimit);
+			high = pivotIndex - 1;
+		}
+	}
+	array_insertion_sort_range(self->data, low, high);
+}
+
+/*
+ * Sort the array with quick sort
+ */
+void array_quick_sort(struct array *self) {
+	if(self->size <= 1) return; // Nothing to sort
+	size_t depthLimit = 0;
+	for(size_t n = self->size; n > 1; n /= 2) depthLimit += 2;
+	introsort_reccu(self, 0, self->size - 1, depthLimit);
+}
+
+#define RADIX_BITS 11
+#define RADIX_BUCKETS (1u << RADIX_BITS)
+#define RADIX_PASSES 3
+
+/*
+ * Flip the sign bit so that negative values come before positive ones when
+ * compared as unsigned
+ */
+static inline uint32_t radix_key(int value) {
+	return (uint32_t)value ^ UINT32_C(0x80000000);
+}
+
+/*
+ * Sort the array with a LSD radix sort, using scratch as temporary storage
+ */
+void array_radix_sort_with(struct array *self, struct array *scratch) {
 	size_t n = self->size;
-	for(size_t i = 0; i < n - 1; i++) {
-		size_t lt = 2 * i + 1;
-		size_t rt = 2 * i + 2;
-		if(lt < n && self->data[lt] > self->data[i]) return false;
-		if(rt < n && self->data[rt] > self->data[i]) return false;
+	if(n <= 1) return; // Nothing to sort
+
+	array_reserve(scratch, n);
+	if(scratch->capacity < n) {
+		// No memory for the second buffer, we sort in place instead
+		array_quick_sort(self);
+		return;
+	}
+
+	// Count all the digits in a single read of the array
+	size_t counts[RADIX_PASSES][RADIX_BUCKETS];
+	memset(counts, 0, sizeof counts);
+	for(size_t i = 0; i < n; i++) {
+		uint32_t key = radix_key(self->data[i]);
+		for(int pass = 0; pass < RADIX_PASSES; pass++) {
+			counts[pass][(key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+		}
+	}
+
+	int *src = self->data;
+	int *dst = scratch->data;
+	for(int pass = 0; pass < RADIX_PASSES; pass++) {
+		unsigned shift = pass * RADIX_BITS;
+		size_t *count = counts[pass];
+
+		// Every element has the same digit, this pass would not move anything
+		if(count[(radix_key(src[0]) >> shift) & (RADIX_BUCKETS - 1)] == n) continue;
+
+		// Turn the counts into starting offsets
+		size_t offset = 0;
+		for(size_t b = 0; b < RADIX_BUCKETS; b++) {
+			size_t c = count[b];
+			count[b] = offset;
+			offset += c;
+		}
+
+		for(size_t i = 0; i < n; i++) {
+			dst[count[(radix_key(src[i]) >> shift) & (RADIX_BUCKETS - 1)]++] = src[i];
+		}
+
+		int *tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+
+	// The sorted data ended in the scratch buffer
+	if(src != self->data) {
+		memcpy(self->data, src, n * sizeof(int));
 	}
-	return true;
 }
 
 /*
- * Add a value into the array considered as a heap
+ * Sort the array with a LSD radix sort (11 bits per pass)
  */
-void array_heap_add(struct array *self, int value) {
-	size_t i = self->size; // Get the size of the heap
-	array_insert(self, value, i);
-	while(i > 0) {
-		size_t j = (i - 1) / 2; // Find location of parent
-		if(self->data[i] <= self->data[j]) break;
-		int tmp = self->data[i];
-		self->data[i] = self->data[j];
-		self->data[j] = tmp; 
-		i = j;
+void array_radix_sort(struct array *self) {
+	struct array scratch;
+	array_create(&scratch);
+	array_radix_sort_with(self, &scratch);
+	array_destroy(&scratch);
+}
+
+/*
+ * Under this size, array_parallel_sort does not start any thread
+ */
+#define PARALLEL_SORT_THRESHOLD (1u << 16)
+
+/*
+ * Number of samples taken per bucket to choose the splitters
+ */
+#define PARALLEL_SORT_OVERSAMPLING 64
+
+#define PARALLEL_SORT_MAX_THREADS 256
+
+struct parallel_sort_shared {
+	int *data;
+	int *scratch;
+	size_t size;
+	unsigned buckets;
+	const int *splitters; // buckets - 1 sorted values
+	size_t *counts; // buckets * buckets, counts[chunk * buckets + bucket]
+	size_t *bucketStart; // buckets + 1
+
+	// The workers wait until participants is known, then separate the phases with
+	// a barrier: the last one to arrive starts a new generation and wakes the others
+	pthread_mutex_t lock;
+	pthread_cond_t ready;
+	unsigned participants;
+	unsigned arrived;
+	unsigned generation;
+};
+
+struct parallel_sort_task {
+	struct parallel_sort_shared *shared;
+	unsigned index;
+};
+
+/*
+ * Find the bucket of the value at index: the number of splitters lower or equal to it.
+ * A value equal to several splitters can go in any of the buckets between them,
+ * they only hold this value, so the values are spread by index to keep the buckets balanced.
+ */
+static unsigned parallel_sort_bucket(const struct parallel_sort_shared *shared, int value, size_t index) {
+	unsigned splitters = shared->buckets - 1;
+	unsigned left = 0;
+	unsigned right = splitters;
+	while(left < right) {
+		unsigned mid = left + (right - left) / 2;
+		if(shared->splitters[mid] < value) left = mid + 1;
+		else right = mid;
+	}
+	if(left == splitters || shared->splitters[left] != value) return left;
+
+	unsigned lower = left;
+	right = splitters;
+	while(left < right) {
+		unsigned mid = left + (right - left) / 2;
+		if(shared->splitters[mid] <= value) left = mid + 1;
+		else right = mid;
 	}
+	// The value is equal to the splitters lower..left-1, so it fits in buckets lower+1..left
+	return lower + 1 + (unsigned)(index * (left - lower) / shared->size);
+}
+
+static void parallel_sort_chunk(const struct parallel_sort_shared *shared, unsigned index, size_t *begin, size_t *end) {
+	*begin = shared->size * index / shared->buckets;
+	*end = shared->size * (index + 1) / shared->buckets;
 }
 
 /*
- * Get the value at the top of the array
+ * Phase 1: count how many values of the chunk go in each bucket
  */
-int array_heap_top(const struct array *self) {
-	return self->data[0];
+static void parallel_sort_count(struct parallel_sort_shared *shared, unsigned index) {
+	size_t *counts = shared->counts + (size_t)index * shared->buckets;
+	size_t begin, end;
+	parallel_sort_chunk(shared, index, &begin, &end);
+	for(size_t i = begin; i < end; i++) {
+		counts[parallel_sort_bucket(shared, shared->data[i], i)]++;
+	}
 }
 
 /*
- * Remove the top value in the array considered as a heap
+ * Between phase 1 and 2: turn the counts into write offsets,
+ * bucket by bucket, then chunk by chunk
  */
-void array_heap_remove_top(struct array *self) {
-    if (self->size > 0) {
-        self->data[0] = self->data[self->size - 1];
-        self->size--;
-        heapify(self, self->size, 0);
-    }
+static void parallel_sort_offsets(struct parallel_sort_shared *shared) {
+	unsigned buckets = shared->buckets;
+	size_t offset = 0;
+	for(unsigned b = 0; b < buckets; b++) {
+		shared->bucketStart[b] = offset;
+		for(unsigned c = 0; c < buckets; c++) {
+			size_t count = shared->counts[(size_t)c * buckets + b];
+			shared->counts[(size_t)c * buckets + b] = offset;
+			offset += count;
+		}
+	}
+	shared->bucketStart[buckets] = offset;
 }
+
 /*
- * Create an empty list
+ * Phase 2: move the values of the chunk to their bucket in the scratch buffer
+ * (counts now hold the offsets where the chunk writes in each bucket)
  */
-void list_create(struct list *self) {
-	self->first = NULL;
-	self->last = NULL;
+static void parallel_sort_scatter(struct parallel_sort_shared *shared, unsigned index) {
+	size_t *offsets = shared->counts + (size_t)index * shared->buckets;
+	size_t begin, end;
+	parallel_sort_chunk(shared, index, &begin, &end);
+	for(size_t i = begin; i < end; i++) {
+		int value = shared->data[i];
+		shared->scratch[offsets[parallel_sort_bucket(shared, value, i)]++] = value;
+	}
 }
 
 /*
- * Create a list with initial content
+ * Phase 3: sort one bucket and copy it back at its final place
  */
-void list_create_from(struct list *self, const int *other, size_t size) {
-	if(self == NULL || other == NULL || size == 0)
-		return;
-	self->first = NULL;
-	self->last = NULL;
-	for(size_t i = 0; i < size; i++) {
+static void parallel_sort_bucket_sort(struct parallel_sort_shared *shared, unsigned index) {
+	size_t begin = shared->bucketStart[index];
+	size_t end = shared->bucketStart[index + 1];
 
-		// We allocate a new node, put the data in it 
-		struct list_node *newNode = malloc(sizeof(struct list_node));
-		if (newNode == NULL) {
-			printf("Allocation error");
-			return;
-		}
-		newNode->data = other[i];
-		newNode->prev = self->last;
-		newNode->next = NULL;
+	// A view on the bucket so that we can reuse array_quick_sort
+	struct array bucket;
+	array_view(&bucket, shared->scratch + begin, end - begin);
+	array_quick_sort(&bucket);
 
-		if(self->last != NULL) {
-			self->last->next = newNode; // Set the last pointer to our new node
-		} else {
-			self->first = newNode;
+	memcpy(shared->data + begin, bucket.data, bucket.size * sizeof(int));
+}
+
+/*
+ * Run a phase on the chunks or buckets of a participant: index, index + participants...
+ */
+static void parallel_sort_phase(struct parallel_sort_shared *shared, unsigned index, void (*phase)(struct parallel_sort_shared *, unsigned)) {
+	for(unsigned i = index; i < shared->buckets; i += shared->participants) {
+		phase(shared, i);
+	}
+}
+
+/*
+ * Wait until all the participants reached the barrier
+ */
+static void parallel_sort_barrier(struct parallel_sort_shared *shared) {
+	pthread_mutex_lock(&shared->lock);
+	unsigned generation = shared->generation;
+	if(++shared->arrived == shared->participants) {
+		shared->arrived = 0;
+		shared->generation++;
+		pthread_cond_broadcast(&shared->ready);
+	} else {
+		while(generation == shared->generation) {
+			pthread_cond_wait(&shared->ready, &shared->lock);
 		}
-		self->last = newNode;
 	}
+	pthread_mutex_unlock(&shared->lock);
 }
 
 /*
- * Destroy a list
+ * All the phases of one participant, the first one also computes the offsets
  */
-void list_destroy(struct list *self) {
-	if(self == NULL) return;
-	struct list_node *curr = self->first;
-	struct list_node *tmp;
-	while(curr != NULL) {
-		tmp = curr; 
-		curr = curr->next;
-		free(tmp);
+static void parallel_sort_steps(struct parallel_sort_shared *shared, unsigned index) {
+	parallel_sort_phase(shared, index, parallel_sort_count);
+	parallel_sort_barrier(shared);
+	if(index == 0) parallel_sort_offsets(shared);
+	parallel_sort_barrier(shared);
+	parallel_sort_phase(shared, index, parallel_sort_scatter);
+	parallel_sort_barrier(shared);
+	parallel_sort_phase(shared, index, parallel_sort_bucket_sort);
+}
+
+static void *parallel_sort_worker(void *arg) {
+	struct parallel_sort_task *task = arg;
+	struct parallel_sort_shared *shared = task->shared;
+	pthread_mutex_lock(&shared->lock);
+	while(shared->participants == 0) {
+		pthread_cond_wait(&shared->ready, &shared->lock);
 	}
-	
-	// Put the values of start and end ptr to NULL
-	self->first = NULL;
-	self->last = NULL;
+	pthread_mutex_unlock(&shared->lock);
+	parallel_sort_steps(shared, task->index);
+	return NULL;
 }
 
 /*
- * Tell if the list is empty
+ * Sample sort with one bucket per thread, samples holds room for
+ * buckets * PARALLEL_SORT_OVERSAMPLING values
+ * The workers are created once, the calling thread is the participant 0
  */
-bool list_empty(const struct list *self) {
-	return self->first == NULL;
+static void parallel_sample_sort(struct parallel_sort_shared *shared, int *samples, struct parallel_sort_task *tasks, pthread_t *ids) {
+	unsigned buckets = shared->buckets;
+	size_t sampleCount = (size_t)buckets * PARALLEL_SORT_OVERSAMPLING;
+
+	// Evenly spaced samples, so the result does not depend on any randomness
+	for(size_t i = 0; i < sampleCount; i++) {
+		samples[i] = shared->data[i * (shared->size / sampleCount)];
+	}
+	struct array sampleView;
+	array_view(&sampleView, samples, sampleCount);
+	array_quick_sort(&sampleView);
+	// The splitters are samples[k * OVERSAMPLING] for k in 1..buckets-1, we pack them at the beginning
+	for(unsigned k = 1; k < buckets; k++) {
+		samples[k - 1] = samples[(size_t)k * PARALLEL_SORT_OVERSAMPLING];
+	}
+	shared->splitters = samples;
+
+	pthread_mutex_init(&shared->lock, NULL);
+	pthread_cond_init(&shared->ready, NULL);
+	shared->participants = 0;
+	shared->arrived = 0;
+	shared->generation = 0;
+
+	unsigned started = 1;
+	for(; started < buckets; started++) {
+		tasks[started].shared = shared;
+		tasks[started].index = started;
+		if(pthread_create(&ids[started], NULL, parallel_sort_worker, &tasks[started]) != 0) break;
+	}
+	// If a thread could not be created, the others share its work
+	pthread_mutex_lock(&shared->lock);
+	shared->participants = started;
+	pthread_cond_broadcast(&shared->ready);
+	pthread_mutex_unlock(&shared->lock);
+
+	parallel_sort_steps(shared, 0);
+
+	for(unsigned i = 1; i < started; i++) {
+		pthread_join(ids[i], NULL);
+	}
+	pthread_cond_destroy(&shared->ready);
+	pthread_mutex_destroy(&shared->lock);
 }
 
-size_t list_size(const struct list *self) {
-	size_t count = 0;
-	struct list_node *curr = self->first;
-	while(curr != NULL) {
-		count++;
-		curr = curr->next;
+/*
+ * Sort the array with a parallel sample sort using up to threads threads
+ */
+void array_parallel_sort(struct array *self, unsigned threads) {
+	array_parallel_sort_profile(self, threads, NULL);
+}
+
+void array_parallel_sort_profile(struct array *self, unsigned threads, size_t *bucket_sizes) {
+	size_t n = self->size;
+	// bucket_sizes has room for the threads asked for, fewer may be used
+	unsigned room = bucket_sizes != NULL ? threads : 0;
+	for(unsigned i = 0; i < room; i++) bucket_sizes[i] = 0;
+	if(threads > PARALLEL_SORT_MAX_THREADS) threads = PARALLEL_SORT_MAX_THREADS;
+	// Each thread should get at least a quarter of the threshold
+	if(threads > n / (PARALLEL_SORT_THRESHOLD / 4)) threads = (unsigned)(n / (PARALLEL_SORT_THRESHOLD / 4));
+	if(n < PARALLEL_SORT_THRESHOLD || threads <= 1) {
+		if(room > 0) bucket_sizes[0] = n;
+		array_quick_sort(self);
+		return;
+	}
+
+	// All the buffers come from the allocator of the array
+	const struct allocator *allocator = self->allocator;
+	size_t scratchBytes = n * sizeof(int);
+	size_t countsBytes = (size_t)threads * threads * sizeof(size_t);
+	size_t bucketStartBytes = (threads + 1) * sizeof(size_t);
+	size_t samplesBytes = (size_t)threads * PARALLEL_SORT_OVERSAMPLING * sizeof(int);
+	size_t tasksBytes = threads * sizeof(struct parallel_sort_task);
+	size_t idsBytes = threads * sizeof(pthread_t);
+
+	struct parallel_sort_shared shared;
+	shared.data = self->data;
+	shared.size = n;
+	shared.buckets = threads;
+	shared.scratch = allocator->allocate(allocator->ctx, scratchBytes);
+	shared.counts = allocator->allocate(allocator->ctx, countsBytes);
+	shared.bucketStart = allocator->allocate(allocator->ctx, bucketStartBytes);
+	int *samples = allocator->allocate(allocator->ctx, samplesBytes);
+	struct parallel_sort_task *tasks = allocator->allocate(allocator->ctx, tasksBytes);
+	pthread_t *ids = allocator->allocate(allocator->ctx, idsBytes);
+	if(shared.counts != NULL) memset(shared.counts, 0, countsBytes);
+
+	if(shared.scratch != NULL && shared.counts != NULL && shared.bucketStart != NULL
+			&& samples != NULL && tasks != NULL && ids != NULL) {
+		parallel_sample_sort(&shared, samples, tasks, ids);
+		if(room > 0) {
+			for(unsigned i = 0; i < threads; i++) bucket_sizes[i] = shared.bucketStart[i + 1] - shared.bucketStart[i];
+		}
+	} else {
+		if(debug) printf("Problem with memory allocation in array_parallel_sort\n");
+		if(room > 0) bucket_sizes[0] = n;
+		array_quick_sort(self);
+	}
+
+	if(shared.scratch != NULL) allocator->deallocate(allocator->ctx, shared.scratch, scratchBytes);
+	if(shared.counts != NULL) allocator->deallocate(allocator->ctx, shared.counts, countsBytes);
+	if(shared.bucketStart != NULL) allocator->deallocate(allocator->ctx, shared.bucketStart, bucketStartBytes);
+	if(samples != NULL) allocator->deallocate(allocator->ctx, samples, samplesBytes);
+	if(tasks != NULL) allocator->deallocate(allocator->ctx, tasks, tasksBytes);
+	if(ids != NULL) allocator->deallocate(allocator->ctx, ids, idsBytes);
+}
+
+/*
+ * Move the value at i down the heap of n elements where each node has arity
+ * children. The value is kept aside and the children are moved up into the
+ * hole, so each level costs one write instead of a swap.
+ */
+static void heapify(int *data, size_t n, size_t i, size_t arity) {
+	int value = data[i];
+	for(;;) {
+		size_t first = arity * i + 1;
+		if(first >= n) break;
+		size_t last = first + arity < n ? first + arity : n;
+		size_t largest = first;
+		for(size_t c = first + 1; c < last; c++) {
+			if(data[c] > data[largest]) largest = c;
+		}
+		if(data[largest] <= value) break;
+		data[i] = data[largest];
+		i = largest;
 	}
-	return count;
+	data[i] = value;
 }
 
 /*
- * Compares the list to an array (data and size) 
+ * Move the value at i up the heap where each node has arity children
  */
-bool list_equals(const struct list *self, const int *data, size_t size) {
-	size_t count = 0;
-	struct list_node *curr = self->first;
-	while(curr != NULL && count < size) {
-		if(*data != curr->data)
-			return false;
-		count++;
-		curr = curr->next;
-		data++;
+static void heap_sift_up(int *data, size_t i, size_t arity) {
+	int value = data[i];
+	while(i > 0) {
+		size_t parent = (i - 1) / arity; // Find location of parent
+		if(value <= data[parent]) break;
+		data[i] = data[parent];
+		i = parent;
 	}
-	if(curr != NULL || count < size) return false; // One is snaller than the other
-	return true;
+	data[i] = value;
 }
 
-void list_push_front(struct list *self, int value) {
-	struct list_node *new = malloc(sizeof(struct list_node));
-	new->data = value;
-	new->prev = NULL;
-	if(list_empty(self)) {
-		new->next = NULL;
-		self->first = new;
-		self->last = new;
-	} else {
-		new->next = self->first;
-		self->first->prev = new;
-		self->first = new;
+/*
+ * Put value in the binary heap of n elements where i is a hole (bottom-up
+ * heapsort). The hole first goes down to a leaf, always on the side of the
+ * larger child, then value goes up from there, but not above i. Since value
+ * usually comes from the bottom of the heap, it rarely goes up and we save
+ * about half of the comparisons of a classical sift-down.
+ */
+static void heap_sink_bottom_up(int *data, size_t n, size_t i, int value) {
+	size_t top = i;
+	size_t child;
+	while((child = 2 * i + 1) < n) {
+		if(child + 1 < n && data[child + 1] > data[child]) child++;
+		data[i] = data[child];
+		i = child;
 	}
-	return;
+	while(i > top) {
+		size_t parent = (i - 1) / 2;
+		if(data[parent] >= value) break;
+		data[i] = data[parent];
+		i = parent;
+	}
+	data[i] = value;
 }
 
-void list_pop_front(struct list *self) {
-	if(self == NULL || self->first == NULL)
-		return; // Nothing to pop
-	else if(self->first->next == NULL) {
-		free(self->first);
-		self->first = NULL;
-		self->last = NULL;
+static void heap_sort_range(int *data, size_t n) {
+	if(n < 2) return;
+
+	// Build max heap
+	for(size_t i = n / 2; i-- > 0;) {
+		heap_sink_bottom_up(data, n, i, data[i]);
+	}
+
+	// Extract elements from the heap one by one
+	for(size_t i = n - 1; i > 0; --i) {
+		// The root (maximum element) goes at the end, the last element fills the hole at the root
+		int value = data[i];
+		data[i] = data[0];
+		heap_sink_bottom_up(data, i, 0, value);
+	}
+}
+
+/*
+ * Sort the array with heap sort
+ * */
+void array_heap_sort(struct array *self) {
+	heap_sort_range(self->data, self->size);
+}
+
+/*
+ * Set the number of children of a node when the array is used as a heap (at least 2)
+ */
+void array_set_heap_arity(struct array *self, size_t arity) {
+	if(arity < 2) {
+		if(debug) printf("Heap arity must be at least 2 in array_set_heap_arity\n");
 		return;
 	}
-	struct list_node *curr = self->first;
-	self->first = self->first->next;
-	free(curr);
+	self->heap_arity = arity;
 }
 
 /*
- * Add an element in the list at the end
+ * Tell if the array is a heap
  */
-void list_push_back(struct list *self, int value) {
-	struct list_node *new = malloc(sizeof(struct list_node));
-	new->data = value;
-	new->next = NULL;
-	if(list_empty(self)) {
-		self->first = new;
-		self->last = new;
-		new->prev = NULL;
-	} else {
-		new->prev = self->last;
-		self->last->next = new;
-		self->last = new;
+bool array_is_heap(const struct array *self) {
+	if(self == NULL || self->size < 1) return true;
+	size_t n = self->size;
+	// Every node is compared to its parent
+	for(size_t i = 1; i < n; i++) {
+		if(self->data[i] > self->data[(i - 1) / self->heap_arity]) return false;
 	}
+	return true;
 }
 
 /*
- * Remove the element at the end of the list
+ * Add a value into the array considered as a heap
  */
-void list_pop_back(struct list *self) {
-	if(list_empty(self)) return;
- 
-	struct list_node *curr = self->last;
-	self->last = self->last->prev;
-	if(self->last != NULL) self->last->next = NULL;
-	else self->first = NULL; // List is empty
-	free(curr);
-	if(self->first->next == NULL) {
-		free(self->first);
-		self->first = NULL;
-		self->last = NULL;
-		return;
+void array_heap_add(struct array *self, int value) {
+	size_t i = self->size; // Get the size of the heap
+	array_push_back(self, value);
+	if(self->size == i) return; // Allocation failed
+	heap_sift_up(self->data, i, self->heap_arity);
+}
+
+/*
+ * Reorganize the content of the array into a heap in O(n)
+ */
+void array_heap_build(struct array *self) {
+	size_t n = self->size;
+	if(n < 2) return;
+	// Sift down every internal node, from the last one up to the root
+	for(size_t i = (n - 2) / self->heap_arity + 1; i-- > 0;) {
+		heapify(self->data, n, i, self->heap_arity);
 	}
 }
 
 /*
- * Insert an element in the list (preserving the order)
- * index is valid or equals to the size of the list (insert at the end)
+ * Add size values from other into the array considered as a heap
  */
-void list_insert(struct list *self, int value, size_t index) {
-	if(index == 0) {
-		list_push_front(self,  value);
+void array_heap_add_bulk(struct array *self, const int *other, size_t size) {
+	size_t oldSize = self->size;
+	array_append_range(self, other, size);
+	if(self->size == oldSize) return; // Nothing added or allocation failed
+
+	// Sifting up each value costs up to size * log(total), rebuilding costs total
+	size_t levels = 0;
+	for(size_t n = self->size; n > 1; n /= self->heap_arity) levels++;
+	if(size * levels >= self->size) {
+		array_heap_build(self);
 		return;
 	}
-	if(self == NULL) return;
-	struct list_node *curr = self->first;
-	//struct list_node *prev = NULL;
-	for(size_t i = 0; i < index - 1; i ++) curr = curr->next; 
-	assert(curr != NULL);
-	struct list_node *new = malloc(sizeof(struct list_node));
-	new->next = curr->next;
-	curr->next = new;
-	new->data = value;
+	for(size_t i = oldSize; i < self->size; i++) {
+		heap_sift_up(self->data, i, self->heap_arity);
+	}
 }
 
 /*
- * Remove an element in the list (preserving the order)
- * index is valid
+ * Get the value at the top of the array
  */
-void list_remove(struct list *self, size_t index) {
-	if(list_empty(self)) return;
-	if(index == 0) {
-		struct list_node *curr = self->first;
-		if(self->first->next == NULL) {
-			self->first = NULL;
-			free(self->first);
-			return;
-		}
-		self->first = self->first->next;
-		free(curr);
+int array_heap_top(const struct array *self) {
+	return self->data[0];
+}
+
+/*
+ * Remove the top value in the array considered as a heap
+ */
+void array_heap_remove_top(struct array *self) {
+	if(self->size > 0) {
+		self->data[0] = self->data[self->size - 1];
+		self->size--;
+		if(self->size > 0) heapify(self->data, self->size, 0, self->heap_arity);
+		array_auto_shrink(self);
+	}
+}
+
+/*
+ * Fill the node k of the Eytzinger layout and its subtrees with an in-order
+ * walk, i is the next index to take from the sorted array
+ */
+static size_t eytzinger_fill(struct eytzinger *index, const int *sorted, size_t i, size_t k) {
+	if(k > index->size) return i;
+	i = eytzinger_fill(index, sorted, i, 2 * k);
+	index->data[k] = sorted[i];
+	index->rank[k] = i;
+	i++;
+	return eytzinger_fill(index, sorted, i, 2 * k + 1);
+}
+
+#define EYTZINGER_ALIGNMENT 64
+
+/*
+ * Build an Eytzinger index from a sorted array, with the allocator of the array
+ */
+void array_build_eytzinger(const struct array *self, struct eytzinger *index) {
+	const struct allocator *allocator = self->allocator;
+	index->size = self->size;
+	index->allocator = allocator;
+	index->data = NULL;
+	index->rank = NULL;
+	index->block = NULL;
+	index->block_size = 0;
+
+	// One more slot because the layout starts at 1
+	// data is aligned on a cache line so that data + 16 * k starts a line, rank follows it
+	size_t slots = self->size + 1;
+	if(slots > (SIZE_MAX - EYTZINGER_ALIGNMENT) / (sizeof(int) + 2 * sizeof(size_t))) {
+		printf("Problem with memory allocation in array_build_eytzinger\n");
+		index->size = 0;
 		return;
 	}
-	struct list_node *curr = self->first;
-	struct list_node *prev = NULL;
-	size_t i = 0;
-	while(i < index && curr != NULL) {
-		prev = curr;
-		curr = curr->next;
-		i++;
+	size_t dataBytes = (slots * sizeof(int) + sizeof(size_t) - 1) / sizeof(size_t) * sizeof(size_t);
+	size_t blockSize = EYTZINGER_ALIGNMENT - 1 + dataBytes + slots * sizeof(size_t);
+	void *block = allocator->allocate(allocator->ctx, blockSize);
+	if(block == NULL) {
+		printf("Problem with memory allocation in array_build_eytzinger\n");
+		index->size = 0;
+		return;
 	}
-	if(curr == NULL) return; // Index is not correct
-	prev->next = curr->next;	
-	if(curr->next != NULL) curr->next->prev = prev;
-	free(curr);
+	uintptr_t address = ((uintptr_t)block + EYTZINGER_ALIGNMENT - 1) & ~(uintptr_t)(EYTZINGER_ALIGNMENT - 1);
+	index->block = block;
+	index->block_size = blockSize;
+	index->data = (int *)address;
+	index->rank = (size_t *)(address + dataBytes);
+
+	// The rank of the "not found" position 0 is the size
+	index->data[0] = 0;
+	index->rank[0] = self->size;
+	eytzinger_fill(index, self->data, 0, 1);
 }
 
-int list_get(const struct list *self, size_t index) {
-	struct list_node *curr = self->first;
-	size_t i = 0;
-	while(i < index && curr != NULL) {
-		curr = curr->next;
-		i++;
+/*
+ * Destroy an Eytzinger index
+ */
+void eytzinger_destroy(struct eytzinger *index) {
+	if(index->block != NULL) index->allocator->deallocate(index->allocator->ctx, index->block, index->block_size);
+	index->block = NULL;
+	index->block_size = 0;
+	index->data = NULL;
+	index->rank = NULL;
+	index->size = 0;
+}
+
+/*
+ * Get the position in the layout of the first element greater or equal to value, or 0 if there is none
+ */
+static size_t eytzinger_position(const struct eytzinger *index, int value) {
+	const int *data = index->data;
+	size_t n = index->size;
+	size_t k = 1;
+	while(k <= n) {
+		// The 16 descendants of k four levels down are data[16 * k..16 * k + 15],
+		// one cache line as data is aligned, we ask for it now
+#ifdef __GNUC__
+		__builtin_prefetch(data + 16 * k);
+#endif
+		k = 2 * k + (data[k] < value); // No branch, the comparison is the next direction
 	}
-	if(curr == NULL) return 0; // i out of bounds
-	return curr->data ;
+	// We went right after the answer then only left: drop those right turns and the last left one
+#ifdef __GNUC__
+	k >>= __builtin_ffsll(~(long long)k);
+#else
+	while(k & 1) k >>= 1;
+	k >>= 1;
+#endif
+	return k;
 }
 
-void list_set(struct list *self, size_t index, int value) {
-	struct list_node *curr = self->first;
-	size_t i = 0;
+/*
+ * Get the index in the sorted array of the first element greater or equal to value, or the size if there is none
+ */
+size_t eytzinger_lower_bound(const struct eytzinger *index, int value) {
+	return index->rank[eytzinger_position(index, value)];
+}
 
-	while(i < index && curr != NULL) {
-		curr = curr->next;
-		i++;
+/*
+ * Search for an element and return its index in the sorted array, or the size if not present
+ */
+size_t eytzinger_search(const struct eytzinger *index, int value) {
+	size_t k = eytzinger_position(index, value);
+	if(k == 0 || index->data[k] != value) return index->size; // No match found
+	return index->rank[k];
+}
+
+/*
+ * Create an empty indexed heap
+ */
+void indexed_heap_create(struct indexed_heap *self) {
+	indexed_heap_create_with(self, allocator_get_default());
+}
+
+/*
+ * Create an empty indexed heap that gets its memory from allocator
+ */
+void indexed_heap_create_with(struct indexed_heap *self, const struct allocator *allocator) {
+	self->heap = NULL;
+	self->position = NULL;
+	self->priority = NULL;
+	self->size = 0;
+	self->capacity = 0;
+	self->allocator = allocator;
+}
+
+/*
+ * Destroy an indexed heap
+ */
+void indexed_heap_destroy(struct indexed_heap *self) {
+	const struct allocator *allocator = self->allocator;
+	if(self->capacity > 0) {
+		allocator->deallocate(allocator->ctx, self->heap, self->capacity * sizeof(size_t));
+		allocator->deallocate(allocator->ctx, self->position, self->capacity * sizeof(size_t));
+		allocator->deallocate(allocator->ctx, self->priority, self->capacity * sizeof(int));
+	}
+	indexed_heap_create_with(self, allocator);
+}
+
+/*
+ * Tell if the indexed heap is empty
+ */
+bool indexed_heap_empty(const struct indexed_heap *self) {
+	return self->size == 0;
+}
+
+/*
+ * Get the number of handles in the indexed heap
+ */
+size_t indexed_heap_size(const struct indexed_heap *self) {
+	return self->size;
+}
+
+/*
+ * Tell if a handle is in the indexed heap
+ */
+bool indexed_heap_contains(const struct indexed_heap *self, size_t handle) {
+	return handle < self->capacity && self->position[handle] != INDEXED_HEAP_NONE;
+}
+
+/*
+ * Make room for handles up to handle (included), growing geometrically
+ */
+static bool indexed_heap_grow(struct indexed_heap *self, size_t handle) {
+	if(handle < self->capacity) return true;
+	size_t newCapacity = self->capacity * 2;
+	if(newCapacity <= handle) newCapacity = handle + 1;
+	if(newCapacity > SIZE_MAX / sizeof(size_t)) {
+		printf("Problem with memory allocation in indexed_heap_grow\n");
+		return false;
+	}
+
+	// A handle is at most once in the heap, so the heap needs as much room as the handles
+	// The three buffers are replaced together, so a failure leaves the heap unchanged
+	const struct allocator *allocator = self->allocator;
+	size_t *heap = allocator->allocate(allocator->ctx, newCapacity * sizeof(size_t));
+	size_t *position = allocator->allocate(allocator->ctx, newCapacity * sizeof(size_t));
+	int *priority = allocator->allocate(allocator->ctx, newCapacity * sizeof(int));
+	if(heap == NULL || position == NULL || priority == NULL) {
+		printf("Problem with memory allocation in indexed_heap_grow\n");
+		if(heap != NULL) allocator->deallocate(allocator->ctx, heap, newCapacity * sizeof(size_t));
+		if(position != NULL) allocator->deallocate(allocator->ctx, position, newCapacity * sizeof(size_t));
+		if(priority != NULL) allocator->deallocate(allocator->ctx, priority, newCapacity * sizeof(int));
+		return false;
+	}
+	if(self->capacity > 0) {
+		memcpy(heap, self->heap, self->size * sizeof(size_t));
+		memcpy(position, self->position, self->capacity * sizeof(size_t));
+		memcpy(priority, self->priority, self->capacity * sizeof(int));
+		allocator->deallocate(allocator->ctx, self->heap, self->capacity * sizeof(size_t));
+		allocator->deallocate(allocator->ctx, self->position, self->capacity * sizeof(size_t));
+		allocator->deallocate(allocator->ctx, self->priority, self->capacity * sizeof(int));
+	}
+	self->heap = heap;
+	self->position = position;
+	self->priority = priority;
+
+	for(size_t i = self->capacity; i < newCapacity; i++) {
+		self->position[i] = INDEXED_HEAP_NONE;
+	}
+	self->capacity = newCapacity;
+	return true;
+}
+
+/*
+ * Move the handle at i up the heap, updating the positions on the way
+ */
+static void indexed_heap_sift_up(struct indexed_heap *self, size_t i) {
+	size_t handle = self->heap[i];
+	int value = self->priority[handle];
+	while(i > 0) {
+		size_t parent = (i - 1) / 2;
+		if(value <= self->priority[self->heap[parent]]) break;
+		self->heap[i] = self->heap[parent];
+		self->position[self->heap[i]] = i;
+		i = parent;
+	}
+	self->heap[i] = handle;
+	self->position[handle] = i;
+}
+
+/*
+ * Move the handle at i down the heap, updating the positions on the way
+ */
+static void indexed_heap_sift_down(struct indexed_heap *self, size_t i) {
+	size_t handle = self->heap[i];
+	int value = self->priority[handle];
+	size_t child;
+	while((child = 2 * i + 1) < self->size) {
+		if(child + 1 < self->size && self->priority[self->heap[child + 1]] > self->priority[self->heap[child]]) child++;
+		if(self->priority[self->heap[child]] <= value) break;
+		self->heap[i] = self->heap[child];
+		self->position[self->heap[i]] = i;
+		i = child;
+	}
+	self->heap[i] = handle;
+	self->position[handle] = i;
+}
+
+/*
+ * Add a handle with a priority and return false if the handle was already present
+ */
+bool indexed_heap_push(struct indexed_heap *self, size_t handle, int priority) {
+	if(handle == INDEXED_HEAP_NONE) return false; // Reserved for the missing handles
+	if(indexed_heap_contains(self, handle)) return false;
+	if(!indexed_heap_grow(self, handle)) return false;
+	self->priority[handle] = priority;
+	self->heap[self->size] = handle;
+	self->size++;
+	indexed_heap_sift_up(self, self->size - 1);
+	return true;
+}
+
+/*
+ * Get the handle with the highest priority
+ */
+size_t indexed_heap_top(const struct indexed_heap *self) {
+	if(self->size == 0) return INDEXED_HEAP_NONE;
+	return self->heap[0];
+}
+
+/*
+ * Get the priority of a handle, or 0 if the handle is not present
+ */
+int indexed_heap_priority(const struct indexed_heap *self, size_t handle) {
+	if(!indexed_heap_contains(self, handle)) return 0;
+	return self->priority[handle];
+}
+
+/*
+ * Remove a handle and return false if the handle was not present
+ */
+bool indexed_heap_remove(struct indexed_heap *self, size_t handle) {
+	if(!indexed_heap_contains(self, handle)) return false;
+	size_t i = self->position[handle];
+	self->position[handle] = INDEXED_HEAP_NONE;
+	self->size--;
+	if(i == self->size) return true; // It was the last one
+	// The last handle fills the hole, it may have to go up or down
+	size_t moved = self->heap[self->size];
+	self->heap[i] = moved;
+	indexed_heap_sift_up(self, i);
+	indexed_heap_sift_down(self, self->position[moved]);
+	return true;
+}
+
+/*
+ * Remove the handle with the highest priority
+ */
+void indexed_heap_pop(struct indexed_heap *self) {
+	if(self->size == 0) return;
+	indexed_heap_remove(self, self->heap[0]);
+}
+
+/*
+ * Lower the priority of a handle and return false if the handle was not present or the priority is higher
+ */
+bool indexed_heap_decrease_key(struct indexed_heap *self, size_t handle, int priority) {
+	if(!indexed_heap_contains(self, handle) || priority > self->priority[handle]) return false;
+	self->priority[handle] = priority;
+	indexed_heap_sift_down(self, self->position[handle]);
+	return true;
+}
+
+/*
+ * Raise the priority of a handle and return false if the handle was not present or the priority is lower
+ */
+bool indexed_heap_increase_key(struct indexed_heap *self, size_t handle, int priority) {
+	if(!indexed_heap_contains(self, handle) || priority < self->priority[handle]) return false;
+	self->priority[handle] = priority;
+	indexed_heap_sift_up(self, self->position[handle]);
+	return true;
+}
+
+/*
+ * Create an empty list
+ */
+void list_create(struct list *self) {
+	list_create_with(self, allocator_get_default());
+}
+
+/*
+ * Create an empty list that gets its nodes from allocator
+ */
+void list_create_with(struct list *self, const struct allocator *allocator) {
+	self->first = NULL;
+	self->last = NULL;
+	self->size = 0;
+	self->allocator = allocator;
+	self->pool = NULL;
+}
+
+/*
+ * Number of nodes in the first chunk of a pool, the next ones double up to the maximum
+ */
+#define LIST_POOL_FIRST_CHUNK 32
+#define LIST_POOL_MAX_CHUNK 4096
+
+struct list_pool_chunk {
+	struct list_pool_chunk *next;
+	size_t count;
+};
+
+// The nodes of a chunk start right after its header
+#define LIST_POOL_HEADER ((sizeof(struct list_pool_chunk) + sizeof(struct list_node) - 1) / sizeof(struct list_node) * sizeof(struct list_node))
+
+struct list_pool {
+	const struct allocator *allocator;
+	size_t refs; // Number of lists using the pool, they can exchange their nodes
+	struct list_pool_chunk *chunks;
+	struct list_node *free_nodes; // Linked with next
+	struct list_node *next_node; // Never used nodes of the last chunk
+	size_t remaining;
+	size_t chunk_nodes;
+};
+
+static struct list_node *list_node_alloc(struct list *self) {
+	const struct allocator *allocator = self->allocator;
+	if(self->pool == NULL) {
+		self->pool = allocator->allocate(allocator->ctx, sizeof(struct list_pool));
+		if(self->pool == NULL) return NULL;
+		self->pool->allocator = allocator;
+		self->pool->refs = 1;
+		self->pool->chunks = NULL;
+		self->pool->free_nodes = NULL;
+		self->pool->next_node = NULL;
+		self->pool->remaining = 0;
+		self->pool->chunk_nodes = LIST_POOL_FIRST_CHUNK;
+	}
+	struct list_pool *pool = self->pool;
+	allocator = pool->allocator;
+
+	// First reuse a freed node
+	if(pool->free_nodes != NULL) {
+		struct list_node *node = pool->free_nodes;
+		pool->free_nodes = node->next;
+		return node;
+	}
+
+	if(pool->remaining == 0) {
+		size_t count = pool->chunk_nodes;
+		struct list_pool_chunk *chunk = allocator->allocate(allocator->ctx, LIST_POOL_HEADER + count * sizeof(struct list_node));
+		if(chunk == NULL) return NULL;
+		chunk->next = pool->chunks;
+		chunk->count = count;
+		pool->chunks = chunk;
+		pool->next_node = (struct list_node *) ((char *) chunk + LIST_POOL_HEADER);
+		pool->remaining = count;
+		if(pool->chunk_nodes < LIST_POOL_MAX_CHUNK) pool->chunk_nodes *= 2;
+	}
+	pool->remaining--;
+	return pool->next_node++;
+}
+
+static void list_node_free(struct list *self, struct list_node *node) {
+	node->next = self->pool->free_nodes;
+	self->pool->free_nodes = node;
+}
+
+/*
+ * Give back all the chunks of the pool, and so all the nodes, at once
+ * If other lists still use the pool, only the nodes of self are given back to it
+ */
+static void list_pool_release(struct list *self) {
+	struct list_pool *pool = self->pool;
+	if(pool == NULL) return;
+	self->pool = NULL;
+	if(--pool->refs > 0) {
+		struct list_node *curr = self->first;
+		while(curr != NULL) {
+			struct list_node *next = curr->next;
+			curr->next = pool->free_nodes;
+			pool->free_nodes = curr;
+			curr = next;
+		}
+		return;
+	}
+	const struct allocator *allocator = pool->allocator;
+	struct list_pool_chunk *chunk = pool->chunks;
+	while(chunk != NULL) {
+		struct list_pool_chunk *next = chunk->next;
+		allocator->deallocate(allocator->ctx, chunk, LIST_POOL_HEADER + chunk->count * sizeof(struct list_node));
+		chunk = next;
+	}
+	allocator->deallocate(allocator->ctx, pool, sizeof(struct list_pool));
+}
+
+/*
+ * Make dst use the pool of src so that nodes can be relinked from one to the other
+ * Not possible if dst still has nodes from another pool
+ */
+static bool list_pool_share(struct list *dst, struct list *src) {
+	if(dst->pool == src->pool || src->pool == NULL) return true;
+	if(dst->first != NULL) return false;
+	list_pool_release(dst);
+	dst->pool = src->pool;
+	dst->pool->refs++;
+	return true;
+}
+
+/*
+ * Create a list with initial content
+ */
+void list_create_from(struct list *self, const int *other, size_t size) {
+	if(self == NULL) return;
+	list_create(self);
+	if(other == NULL || size == 0)
+		return;
+	for(size_t i = 0; i < size; i++) {
+		list_push_back(self, other[i]);
+	}
+}
+
+/*
+ * Destroy a list
+ */
+void list_destroy(struct list *self) {
+	if(self == NULL) return;
+	// The nodes are released with their chunks, no need to walk the list
+	list_pool_release(self);
+
+	// Put the values of start and end ptr to NULL
+	self->first = NULL;
+	self->last = NULL;
+	self->size = 0;
+}
+
+/*
+ * Tell if the list is empty
+ */
+bool list_empty(const struct list *self) {
+	return self->first == NULL;
+}
+
+size_t list_size(const struct list *self) {
+	return self->size;
+}
+
+/*
+ * Compares the list to an array (data and size) 
+ */
+bool list_equals(const struct list *self, const int *data, size_t size) {
+	if(self->size != size) return false; // One is smaller than the other
+	struct list_node *curr = self->first;
+	while(curr != NULL) {
+		if(*data != curr->data)
+			return false;
+		curr = curr->next;
+		data++;
+	}
+	return true;
+}
+
+/*
+ * Link node in the list before next, or at the end if next is NULL
+ */
+static void list_link_before(struct list *self, struct list_node *node, struct list_node *next) {
+	node->next = next;
+	node->prev = next != NULL ? next->prev : self->last;
+	if(node->prev != NULL) node->prev->next = node;
+	else self->first = node;
+	if(next != NULL) next->prev = node;
+	else self->last = node;
+	self->size++;
+}
+
+/*
+ * Take node out of the list (it is not freed)
+ */
+static void list_unlink(struct list *self, struct list_node *node) {
+	if(node->prev != NULL) node->prev->next = node->next;
+	else self->first = node->next;
+	if(node->next != NULL) node->next->prev = node->prev;
+	else self->last = node->prev;
+	self->size--;
+}
+
+/*
+ * Get the node at index, or NULL if the index is not valid
+ * We start from the nearest end of the list
+ */
+static struct list_node *list_node_at(const struct list *self, size_t index) {
+	if(index >= self->size) return NULL;
+	struct list_node *curr;
+	if(index < self->size / 2) {
+		curr = self->first;
+		for(size_t i = 0; i < index; i++) curr = curr->next;
+	} else {
+		curr = self->last;
+		for(size_t i = self->size - 1; i > index; i--) curr = curr->prev;
+	}
+	return curr;
+}
+
+/*
+ * Allocate a node for value and link it before next, or at the end if next is NULL
+ */
+static void list_insert_before(struct list *self, int value, struct list_node *next) {
+	struct list_node *new = list_node_alloc(self);
+	if(new == NULL) {
+		printf("Allocation error");
+		return;
+	}
+	new->data = value;
+	list_link_before(self, new, next);
+}
+
+static void list_erase(struct list *self, struct list_node *node) {
+	list_unlink(self, node);
+	list_node_free(self, node);
+}
+
+void list_push_front(struct list *self, int value) {
+	list_insert_before(self, value, self->first);
+}
+
+void list_pop_front(struct list *self) {
+	if(self == NULL || self->first == NULL)
+		return; // Nothing to pop
+	list_erase(self, self->first);
+}
+
+/*
+ * Add an element in the list at the end
+ */
+void list_push_back(struct list *self, int value) {
+	list_insert_before(self, value, NULL);
+}
+
+/*
+ * Remove the element at the end of the list
+ */
+void list_pop_back(struct list *self) {
+	if(list_empty(self)) return;
+	list_erase(self, self->last);
+}
+
+/*
+ * Insert an element in the list (preserving the order)
+ * index is valid or equals to the size of the list (insert at the end)
+ */
+void list_insert(struct list *self, int value, size_t index) {
+	if(self == NULL || index > self->size) return;
+	list_insert_before(self, value, list_node_at(self, index));
+}
+
+/*
+ * Remove an element in the list (preserving the order)
+ * index is valid
+ */
+void list_remove(struct list *self, size_t index) {
+	struct list_node *curr = list_node_at(self, index);
+	if(curr == NULL) return; // Index is not correct
+	list_erase(self, curr);
+}
+
+int list_get(const struct list *self, size_t index) {
+	struct list_node *curr = list_node_at(self, index);
+	if(curr == NULL) return 0; // i out of bounds
+	return curr->data;
+}
+
+void list_set(struct list *self, size_t index, int value) {
+	struct list_node *curr = list_node_at(self, index);
+	if(curr != NULL) curr->data = value;
+}
+
+/*
+ * Search for an element in the list and return its index or the size of the list if not present.
+ */
+size_t list_search(const struct list *self, int value) {
+	size_t i = 0;
+	struct list_node *curr = self->first;
+	while(curr != NULL) {
+		if(curr->data == value) return i;
+		curr = curr->next;	
+		i++;
+	}
+	return i;
+}
+
+bool list_is_sorted(const struct list *self) {
+	if(self == NULL || self->first == NULL) return true;
+	if(self->first->data > self->last->data) return false;
+	struct list_node *curr = self->first;
+	while(curr->next != NULL) {
+		if(curr->next->data < curr->data) return false;
+		curr = curr->next;
+	}
+	return true;
+}
+
+/*
+ * Move the count first nodes of src at the end of dst
+ * The nodes are relinked, they are only copied if the lists can not share a pool
+ */
+static void list_move_front(struct list *dst, struct list *src, size_t count) {
+	if(count == 0) return;
+	if(!list_pool_share(dst, src)) {
+		for(size_t i = 0; i < count; i++) {
+			list_push_back(dst, src->first->data);
+			list_pop_front(src);
+		}
+		return;
+	}
+	struct list_node *first = src->first;
+	struct list_node *last = list_node_at(src, count - 1);
+
+	// Unlink the chain from src
+	src->first = last->next;
+	if(src->first != NULL) src->first->prev = NULL;
+	else src->last = NULL;
+	src->size -= count;
+
+	// And link it at the end of dst
+	first->prev = dst->last;
+	last->next = NULL;
+	if(dst->last != NULL) dst->last->next = first;
+	else dst->first = first;
+	dst->last = last;
+	dst->size += count;
+}
+
+/*
+ * Split a list in two. At the end, self should be empty.
+ */
+void list_split(struct list *self, struct list *out1, struct list *out2) {
+	size_t size = list_size(self); // Get the size
+	list_move_front(out1, self, size / 2);
+	list_move_front(out2, self, size - size / 2);
+	assert(self->first == NULL); // Makes sure self if empty
+}
+
+/*
+ * Merge two sorted lists in an empty list. At the end, in1 and in2 should be empty.
+ */
+void list_merge(struct list *self, struct list *in1, struct list *in2) {
+	if(!list_pool_share(self, in1) || !list_pool_share(self, in2)) {
+		// Some nodes come from another pool, copy them
+		while(in1->first != NULL && in2->first != NULL) {
+			struct list *in = in2->first->data < in1->first->data ? in2 : in1;
+			list_push_back(self, in->first->data);
+			list_pop_front(in);
+		}
+	} else {
+		while(in1->first != NULL && in2->first != NULL) {
+			struct list *in = in2->first->data < in1->first->data ? in2 : in1;
+			list_move_front(self, in, 1);
+		}
+	}
+	// Finish to fill self if needed
+	list_move_front(self, in1, in1->size);
+	list_move_front(self, in2, in2->size);
+}
+
+/*
+ * Sort a list with merge sort
+ */
+void list_merge_sort(struct list *self) {
+	if(list_size(self) < 2) return;
+
+	// Create, the lists borrow the nodes of self so nothing is allocated
+	struct list first;
+	struct list last; 
+	list_create_with(&first, self->allocator);
+	list_create_with(&last, self->allocator);
+
+	// Split & merge
+	list_split(self, &first, &last);
+	list_merge_sort(&first);
+	list_merge_sort(&last);
+	list_merge(self, &first, &last);
+
+	// Destroy
+	list_destroy(&first);
+	list_destroy(&last);
+}
+
+/*
+ * Cut a chain of nodes after count nodes and return the rest
+ */
+static struct list_node *list_chain_cut(struct list_node *chain, size_t count) {
+	for(size_t i = 1; chain != NULL && i < count; i++) {
+		chain = chain->next;
+	}
+	if(chain == NULL) return NULL;
+	struct list_node *rest = chain->next;
+	chain->next = NULL;
+	return rest;
+}
+
+void list_merge_sort_bottom_up(struct list *self) {
+	if(list_size(self) < 2) return;
+	struct list_node *head = self->first;
+
+	// Only the next links are maintained while merging runs of width nodes
+	for(size_t width = 1; width < self->size; width *= 2) {
+		struct list_node *rest = head;
+		struct list_node *tail = NULL;
+		head = NULL;
+
+		while(rest != NULL) {
+			struct list_node *left = rest;
+			struct list_node *right = list_chain_cut(left, width);
+			rest = list_chain_cut(right, width);
+
+			// Merge left and right at the end of the new chain
+			while(left != NULL || right != NULL) {
+				struct list_node *next;
+				if(right == NULL || (left != NULL && left->data <= right->data)) {
+					next = left;
+					left = left->next;
+				} else {
+					next = right;
+					right = right->next;
+				}
+				if(tail == NULL) head = next;
+				else tail->next = next;
+				tail = next;
+			}
+		}
+		tail->next = NULL;
+	}
+
+	// Restore the prev links
+	struct list_node *prev = NULL;
+	for(struct list_node *curr = head; curr != NULL; curr = curr->next) {
+		curr->prev = prev;
+		prev = curr;
+	}
+	self->first = head;
+	self->last = prev;
+}
+
+void list_to_array(const struct list *self, struct array *out) {
+	out->size = 0;
+	array_reserve(out, self->size);
+	if(out->capacity < self->size) return; // Allocation error
+	for(struct list_node *curr = self->first; curr != NULL; curr = curr->next) {
+		out->data[out->size++] = curr->data;
+	}
+}
+
+void list_assign_from_array(struct list *self, const int *data, size_t size) {
+	size_t i = 0;
+	for(struct list_node *curr = self->first; curr != NULL && i < size; curr = curr->next) {
+		curr->data = data[i++];
+	}
+	// Adjust the number of nodes
+	while(self->size > size) {
+		list_pop_back(self);
+	}
+	for(; i < size; i++) {
+		list_push_back(self, data[i]);
+	}
+}
+
+void list_sort_contiguous(struct list *self, size_t max_bytes) {
+	size_t n = list_size(self);
+	if(n < 2) return;
+	if(n > max_bytes / sizeof(int)) {
+		list_merge_sort(self);
+		return;
+	}
+
+	struct array buffer;
+	array_create_with(&buffer, self->allocator);
+	list_to_array(self, &buffer);
+	if(buffer.size != n) {
+		array_destroy(&buffer);
+		list_merge_sort(self);
+		return;
+	}
+
+	// Radix sort needs a second buffer, quick sort works in place
+	if(n <= max_bytes / sizeof(int) / 2) {
+		struct array scratch;
+		array_create_with(&scratch, self->allocator);
+		array_radix_sort_with(&buffer, &scratch);
+		array_destroy(&scratch);
+	} else {
+		array_quick_sort(&buffer);
+	}
+
+	list_assign_from_array(self, buffer.data, n);
+	array_destroy(&buffer);
+}
+
+void list_cursor_first(struct list_cursor *self, struct list *list) {
+	self->list = list;
+	self->node = list->first;
+}
+
+void list_cursor_last(struct list_cursor *self, struct list *list) {
+	self->list = list;
+	self->node = list->last;
+}
+
+bool list_cursor_valid(const struct list_cursor *self) {
+	return self->node != NULL;
+}
+
+void list_cursor_next(struct list_cursor *self) {
+	if(self->node != NULL) self->node = self->node->next;
+}
+
+void list_cursor_prev(struct list_cursor *self) {
+	self->node = self->node != NULL ? self->node->prev : self->list->last;
+}
+
+int list_cursor_get(const struct list_cursor *self) {
+	if(self->node == NULL) return 0; // Past the end
+	return self->node->data;
+}
+
+void list_cursor_set(struct list_cursor *self, int value) {
+	if(self->node != NULL) self->node->data = value;
+}
+
+void list_cursor_insert_before(struct list_cursor *self, int value) {
+	list_insert_before(self->list, value, self->node);
+}
+
+void list_cursor_insert_after(struct list_cursor *self, int value) {
+	if(self->node == NULL) return; // Nothing after the end
+	list_insert_before(self->list, value, self->node->next);
+}
+
+void list_cursor_erase(struct list_cursor *self) {
+	struct list_node *node = self->node;
+	if(node == NULL) return;
+	self->node = node->next;
+	list_erase(self->list, node);
+}
+
+/*
+ * Create an empty unrolled list
+ */
+void unrolled_list_create(struct unrolled_list *self) {
+	unrolled_list_create_with(self, allocator_get_default());
+}
+
+/*
+ * Create an empty unrolled list that gets its nodes from allocator
+ */
+void unrolled_list_create_with(struct unrolled_list *self, const struct allocator *allocator) {
+	self->first = NULL;
+	self->last = NULL;
+	self->size = 0;
+	self->allocator = allocator;
+}
+
+/*
+ * Allocate an empty node and link it after prev, or at the beginning if prev is NULL
+ */
+static struct unrolled_list_node *unrolled_list_node_insert_after(struct unrolled_list *self, struct unrolled_list_node *prev) {
+	const struct allocator *allocator = self->allocator;
+	struct unrolled_list_node *node = allocator->allocate(allocator->ctx, sizeof(struct unrolled_list_node));
+	if(node == NULL) {
+		printf("Allocation error");
+		return NULL;
+	}
+	node->count = 0;
+	node->prev = prev;
+	node->next = prev != NULL ? prev->next : self->first;
+	if(node->next != NULL) node->next->prev = node;
+	else self->last = node;
+	if(prev != NULL) prev->next = node;
+	else self->first = node;
+	return node;
+}
+
+static void unrolled_list_node_erase(struct unrolled_list *self, struct unrolled_list_node *node) {
+	if(node->prev != NULL) node->prev->next = node->next;
+	else self->first = node->next;
+	if(node->next != NULL) node->next->prev = node->prev;
+	else self->last = node->prev;
+	self->allocator->deallocate(self->allocator->ctx, node, sizeof(struct unrolled_list_node));
+}
+
+/*
+ * Find the node holding index and the offset of index in it
+ * We start from the nearest end of the list
+ */
+static struct unrolled_list_node *unrolled_list_node_at(const struct unrolled_list *self, size_t index, size_t *offset) {
+	if(index >= self->size) return NULL;
+	struct unrolled_list_node *curr;
+	if(index < self->size / 2) {
+		curr = self->first;
+		while(index >= curr->count) {
+			index -= curr->count;
+			curr = curr->next;
+		}
+	} else {
+		size_t remaining = self->size - index; // Elements from index to the end
+		curr = self->last;
+		while(remaining > curr->count) {
+			remaining -= curr->count;
+			curr = curr->prev;
+		}
+		index = curr->count - remaining;
+	}
+	*offset = index;
+	return curr;
+}
+
+void unrolled_list_create_from(struct unrolled_list *self, const int *other, size_t size) {
+	if(self == NULL) return;
+	unrolled_list_create(self);
+	if(other == NULL) return;
+	for(size_t i = 0; i < size; i++) {
+		unrolled_list_push_back(self, other[i]);
+	}
+}
+
+void unrolled_list_destroy(struct unrolled_list *self) {
+	if(self == NULL) return;
+	const struct allocator *allocator = self->allocator;
+	struct unrolled_list_node *curr = self->first;
+	while(curr != NULL) {
+		struct unrolled_list_node *next = curr->next;
+		allocator->deallocate(allocator->ctx, curr, sizeof(struct unrolled_list_node));
+		curr = next;
+	}
+	self->first = NULL;
+	self->last = NULL;
+	self->size = 0;
+}
+
+bool unrolled_list_empty(const struct unrolled_list *self) {
+	return self->size == 0;
+}
+
+size_t unrolled_list_size(const struct unrolled_list *self) {
+	return self->size;
+}
+
+bool unrolled_list_equals(const struct unrolled_list *self, const int *data, size_t size) {
+	if(self->size != size) return false;
+	for(struct unrolled_list_node *curr = self->first; curr != NULL; curr = curr->next) {
+		if(memcmp(curr->data, data, curr->count * sizeof(int)) != 0) return false;
+		data += curr->count;
+	}
+	return true;
+}
+
+void unrolled_list_push_front(struct unrolled_list *self, int value) {
+	unrolled_list_insert(self, value, 0);
+}
+
+void unrolled_list_pop_front(struct unrolled_list *self) {
+	if(self == NULL || self->size == 0) return; // Nothing to pop
+	unrolled_list_remove(self, 0);
+}
+
+void unrolled_list_push_back(struct unrolled_list *self, int value) {
+	struct unrolled_list_node *node = self->last;
+	// Appending fills the nodes completely
+	if(node == NULL || node->count == UNROLLED_LIST_NODE_CAPACITY) {
+		node = unrolled_list_node_insert_after(self, self->last);
+		if(node == NULL) return;
+	}
+	node->data[node->count++] = value;
+	self->size++;
+}
+
+void unrolled_list_pop_back(struct unrolled_list *self) {
+	if(self == NULL || self->size == 0) return;
+	unrolled_list_remove(self, self->size - 1);
+}
+
+void unrolled_list_insert(struct unrolled_list *self, int value, size_t index) {
+	if(self == NULL || index > self->size) return;
+	if(index == self->size) {
+		unrolled_list_push_back(self, value);
+		return;
+	}
+	size_t offset;
+	struct unrolled_list_node *node = unrolled_list_node_at(self, index, &offset);
+	if(node->count == UNROLLED_LIST_NODE_CAPACITY) {
+		// Split the node, the upper half goes in a new node
+		struct unrolled_list_node *next = unrolled_list_node_insert_after(self, node);
+		if(next == NULL) return;
+		unsigned half = node->count / 2;
+		next->count = node->count - half;
+		memcpy(next->data, node->data + half, next->count * sizeof(int));
+		node->count = half;
+		if(offset > half) {
+			offset -= half;
+			node = next;
+		}
+	}
+	memmove(node->data + offset + 1, node->data + offset, (node->count - offset) * sizeof(int));
+	node->data[offset] = value;
+	node->count++;
+	self->size++;
+}
+
+void unrolled_list_remove(struct unrolled_list *self, size_t index) {
+	size_t offset;
+	struct unrolled_list_node *node = unrolled_list_node_at(self, index, &offset);
+	if(node == NULL) return; // Index is not correct
+	node->count--;
+	memmove(node->data + offset, node->data + offset + 1, (node->count - offset) * sizeof(int));
+	self->size--;
+
+	if(node->count == 0) {
+		unrolled_list_node_erase(self, node);
+		return;
+	}
+	if(node->count >= UNROLLED_LIST_NODE_CAPACITY / 2) return;
+
+	// Merge with a neighbour so that the nodes stay at least half full
+	struct unrolled_list_node *next = node->next;
+	if(next == NULL) {
+		next = node;
+		node = node->prev;
+	}
+	if(node != NULL && node->count + next->count <= UNROLLED_LIST_NODE_CAPACITY) {
+		memcpy(node->data + node->count, next->data, next->count * sizeof(int));
+		node->count += next->count;
+		unrolled_list_node_erase(self, next);
+	}
+}
+
+int unrolled_list_get(const struct unrolled_list *self, size_t index) {
+	size_t offset;
+	struct unrolled_list_node *node = unrolled_list_node_at(self, index, &offset);
+	if(node == NULL) return 0; // i out of bounds
+	return node->data[offset];
+}
+
+void unrolled_list_set(struct unrolled_list *self, size_t index, int value) {
+	size_t offset;
+	struct unrolled_list_node *node = unrolled_list_node_at(self, index, &offset);
+	if(node != NULL) node->data[offset] = value;
+}
+
+size_t unrolled_list_search(const struct unrolled_list *self, int value) {
+	size_t i = 0;
+	for(struct unrolled_list_node *curr = self->first; curr != NULL; curr = curr->next) {
+		for(unsigned j = 0; j < curr->count; j++) {
+			if(curr->data[j] == value) return i + j;
+		}
+		i += curr->count;
+	}
+	return i;
+}
+
+bool unrolled_list_is_sorted(const struct unrolled_list *self) {
+	if(self == NULL || self->first == NULL) return true;
+	int prev = self->first->data[0];
+	for(struct unrolled_list_node *curr = self->first; curr != NULL; curr = curr->next) {
+		for(unsigned j = 0; j < curr->count; j++) {
+			if(curr->data[j] < prev) return false;
+			prev = curr->data[j];
+		}
+	}
+	return true;
+}
+
+/*
+ * Merge the run of nodes left..right (excluded) with the run right..end (excluded)
+ * The merged values are written back in the same slots: the tail of the right run
+ * that is left once the left run is exhausted is already at its place
+ */
+static void unrolled_list_merge_runs(struct unrolled_list_node *left, struct unrolled_list_node *right, struct unrolled_list_node *end, int *scratch) {
+	struct unrolled_list_node *a = left;
+	struct unrolled_list_node *b = right;
+	unsigned i = 0;
+	unsigned j = 0;
+	size_t k = 0;
+	while(a != right && b != end) {
+		// Take from the left run on ties to keep the sort stable
+		if(b->data[j] < a->data[i]) {
+			scratch[k++] = b->data[j];
+			if(++j == b->count) {
+				b = b->next;
+				j = 0;
+			}
+		} else {
+			scratch[k++] = a->data[i];
+			if(++i == a->count) {
+				a = a->next;
+				i = 0;
+			}
+		}
+	}
+	while(a != right) {
+		scratch[k++] = a->data[i];
+		if(++i == a->count) {
+			a = a->next;
+			i = 0;
+		}
+	}
+
+	struct unrolled_list_node *node = left;
+	for(size_t m = 0; m < k; node = node->next) {
+		size_t count = node->count < k - m ? node->count : k - m;
+		memcpy(node->data, scratch + m, count * sizeof(int));
+		m += count;
+	}
+}
+
+/*
+ * Sort the unrolled list with a stable bottom-up merge sort on runs of nodes
+ * Each node is sorted first, then runs of 1, 2, 4... nodes are merged
+ */
+void unrolled_list_merge_sort(struct unrolled_list *self) {
+	if(self->size < 2) return;
+
+	// Insertion sort inside the nodes, they are small
+	for(struct unrolled_list_node *curr = self->first; curr != NULL; curr = curr->next) {
+		for(unsigned i = 1; i < curr->count; i++) {
+			int value = curr->data[i];
+			unsigned j = i;
+			for(; j > 0 && curr->data[j - 1] > value; j--) {
+				curr->data[j] = curr->data[j - 1];
+			}
+			curr->data[j] = value;
+		}
+	}
+	if(self->first == self->last) return;
+
+	const struct allocator *allocator = self->allocator;
+	int *scratch = allocator->allocate(allocator->ctx, self->size * sizeof(int));
+	if(scratch == NULL) {
+		printf("Allocation error");
+		return;
+	}
+
+	size_t runs;
+	for(size_t width = 1; ; width *= 2) {
+		runs = 0;
+		struct unrolled_list_node *left = self->first;
+		while(left != NULL) {
+			runs++;
+			struct unrolled_list_node *right = left;
+			for(size_t i = 0; i < width && right != NULL; i++) right = right->next;
+			if(right == NULL) break; // A last run without a pair
+			struct unrolled_list_node *end = right;
+			for(size_t i = 0; i < width && end != NULL; i++) end = end->next;
+			unrolled_list_merge_runs(left, right, end, scratch);
+			left = end;
+		}
+		if(runs <= 1) break;
+	}
+
+	allocator->deallocate(allocator->ctx, scratch, self->size * sizeof(int));
+}
+
+struct skip_list_node {
+	int data;
+	unsigned level;
+	struct skip_list_link links[]; // links[0] is the next node in the list
+};
+
+/*
+ * Create an empty skip list
+ */
+void skip_list_create(struct skip_list *self) {
+	skip_list_create_with(self, allocator_get_default());
+}
+
+/*
+ * Create an empty skip list that gets its nodes from allocator
+ */
+void skip_list_create_with(struct skip_list *self, const struct allocator *allocator) {
+	for(size_t i = 0; i < SKIP_LIST_MAX_LEVEL; i++) {
+		self->head[i].next = NULL;
+		self->head[i].span = 0;
+	}
+	self->level = 1;
+	self->size = 0;
+	self->seed = 0x9E3779B97F4A7C15ULL;
+	self->allocator = allocator;
+}
+
+void skip_list_create_from(struct skip_list *self, const int *other, size_t size) {
+	if(self == NULL) return;
+	skip_list_create(self);
+	if(other == NULL) return;
+	for(size_t i = 0; i < size; i++) {
+		skip_list_push_back(self, other[i]);
+	}
+}
+
+static size_t skip_list_node_bytes(unsigned level) {
+	return sizeof(struct skip_list_node) + level * sizeof(struct skip_list_link);
+}
+
+void skip_list_destroy(struct skip_list *self) {
+	if(self == NULL) return;
+	const struct allocator *allocator = self->allocator;
+	struct skip_list_node *curr = self->head[0].next;
+	while(curr != NULL) {
+		struct skip_list_node *next = curr->links[0].next;
+		allocator->deallocate(allocator->ctx, curr, skip_list_node_bytes(curr->level));
+		curr = next;
+	}
+	skip_list_create_with(self, allocator);
+}
+
+bool skip_list_empty(const struct skip_list *self) {
+	return self->size == 0;
+}
+
+size_t skip_list_size(const struct skip_list *self) {
+	return self->size;
+}
+
+bool skip_list_equals(const struct skip_list *self, const int *data, size_t size) {
+	if(self->size != size) return false;
+	for(struct skip_list_node *curr = self->head[0].next; curr != NULL; curr = curr->links[0].next) {
+		if(curr->data != *data) return false;
+		data++;
 	}
-	if(curr != NULL) curr->data = value;
+	return true;
 }
 
 /*
- * Search for an element in the list and return its index or the size of the list if not present.
+ * Draw the level of a new node, each level is kept with a probability of 1/4
  */
-size_t list_search(const struct list *self, int value) {
-	size_t i = 0;
-	struct list_node *curr = self->first;
-	while(curr != NULL) {
-		if(curr->data == value) return i;
-		curr = curr->next;	
-		i++;
+static unsigned skip_list_random_level(struct skip_list *self) {
+	// xorshift64*
+	self->seed ^= self->seed >> 12;
+	self->seed ^= self->seed << 25;
+	self->seed ^= self->seed >> 27;
+	unsigned long long bits = (self->seed * 0x2545F4914F6CDD1DULL) >> 32;
+	unsigned level = 1;
+	while(level < SKIP_LIST_MAX_LEVEL && (bits & 3) == 0) {
+		level++;
+		bits >>= 2;
 	}
-	return i;
+	return level;
 }
 
-bool list_is_sorted(const struct list *self) {
-	if(self == NULL || self->first == NULL) return true;
-	if(self->first->data > self->last->data) return false;
-	struct list_node *curr = self->first;
-	while(curr->next != NULL) {
-		if(curr->next->data < curr->data) return false;
-		curr = curr->next;
+/*
+ * Find at each level the last links before the element at index
+ * position is the number of elements before the owner of the link (0 for the head)
+ */
+static void skip_list_find(struct skip_list *self, size_t index, struct skip_list_link **update, size_t *position) {
+	struct skip_list_link *links = self->head;
+	size_t rank = 0;
+	for(unsigned i = self->level; i-- > 0;) {
+		while(links[i].next != NULL && rank + links[i].span <= index) {
+			rank += links[i].span;
+			links = links[i].next->links;
+		}
+		update[i] = &links[i];
+		position[i] = rank;
 	}
-	return true;
 }
 
 /*
- * Split a list in two. At the end, self should be empty.
+ * Get the node at index, or NULL if the index is not valid
  */
-void list_split(struct list *self, struct list *out1, struct list *out2) {
-	size_t size = list_size(self); // Get the size
-	for(size_t i = 0; i < size; i++) {
-		if(i < size / 2) {
-			// If i < size / 2 but in out1
-			list_push_back(out1, self->first->data);
-			list_pop_front(self);
-		} else {
-			// Else put in out2
-			list_push_back(out2, self->first->data);
-			list_pop_front(self);
+static struct skip_list_node *skip_list_node_at(const struct skip_list *self, size_t index) {
+	if(index >= self->size) return NULL;
+	const struct skip_list_link *links = self->head;
+	size_t rank = 0; // Rank of the node owning links, the first node has rank 1
+	for(unsigned i = self->level; i-- > 0;) {
+		while(links[i].next != NULL && rank + links[i].span <= index + 1) {
+			rank += links[i].span;
+			if(rank == index + 1) return links[i].next;
+			links = links[i].next->links;
+		}
+	}
+	return NULL;
+}
+
+void skip_list_insert(struct skip_list *self, int value, size_t index) {
+	if(self == NULL || index > self->size) return;
+	struct skip_list_link *update[SKIP_LIST_MAX_LEVEL];
+	size_t position[SKIP_LIST_MAX_LEVEL];
+	skip_list_find(self, index, update, position);
+
+	unsigned level = skip_list_random_level(self);
+	if(level > self->level) {
+		for(unsigned i = self->level; i < level; i++) {
+			update[i] = &self->head[i];
+			update[i]->span = self->size;
+			position[i] = 0;
 		}
+		self->level = level;
+	}
 
+	const struct allocator *allocator = self->allocator;
+	struct skip_list_node *node = allocator->allocate(allocator->ctx, skip_list_node_bytes(level));
+	if(node == NULL) {
+		printf("Allocation error");
+		return;
 	}
-	assert(self->first == NULL); // Makes sure self if empty
+	node->data = value;
+	node->level = level;
+	for(unsigned i = 0; i < level; i++) {
+		size_t before = index - position[i]; // Elements between the owner of the link and the new node
+		node->links[i].next = update[i]->next;
+		node->links[i].span = update[i]->span - before;
+		update[i]->next = node;
+		update[i]->span = before + 1;
+	}
+	// The higher links now jump over one more element
+	for(unsigned i = level; i < self->level; i++) {
+		update[i]->span++;
+	}
+	self->size++;
 }
 
-/*
- * Merge two sorted lists in an empty list. At the end, in1 and in2 should be empty.
- */
-void list_merge(struct list *self, struct list *in1, struct list *in2) {
-	while(in1->first != NULL && in2->first != NULL) {
-		if(in1->first->data < in2->first->data) {
-			list_push_back(self, in1->first->data);
-			list_pop_front(in1);
+void skip_list_remove(struct skip_list *self, size_t index) {
+	if(self == NULL || index >= self->size) return; // Index is not correct
+	struct skip_list_link *update[SKIP_LIST_MAX_LEVEL];
+	size_t position[SKIP_LIST_MAX_LEVEL];
+	skip_list_find(self, index, update, position);
+
+	struct skip_list_node *node = update[0]->next;
+	for(unsigned i = 0; i < self->level; i++) {
+		if(update[i]->next == node) {
+			update[i]->span += node->links[i].span - 1;
+			update[i]->next = node->links[i].next;
 		} else {
-			list_push_back(self, in2->first->data);
-			list_pop_front(in2);
+			update[i]->span--;
 		}
 	}
-	// Finish to fill self if needed
-	while(in1->first != NULL) {
-		list_push_back(self, in1->first->data);
-		list_pop_front(in1);
+	while(self->level > 1 && self->head[self->level - 1].next == NULL) {
+		self->level--;
 	}
+	self->allocator->deallocate(self->allocator->ctx, node, skip_list_node_bytes(node->level));
+	self->size--;
+}
 
-	while(in2->first != NULL) {
-		list_push_back(self, in2->first->data);
-		list_pop_front(in2);
-	}
+void skip_list_push_front(struct skip_list *self, int value) {
+	skip_list_insert(self, value, 0);
+}
 
+void skip_list_pop_front(struct skip_list *self) {
+	skip_list_remove(self, 0);
 }
 
-/*
- * Sort a list with merge sort
- */
-void list_merge_sort(struct list *self) {
-	if(list_size(self) < 2) return;
+void skip_list_push_back(struct skip_list *self, int value) {
+	skip_list_insert(self, value, self->size);
+}
 
-	// Create
-	struct list first;
-	struct list last; 
-	list_create(&first);
-	list_create(&last);
+void skip_list_pop_back(struct skip_list *self) {
+	if(self == NULL || self->size == 0) return;
+	skip_list_remove(self, self->size - 1);
+}
 
-	// Split & merge
-	list_split(self, &first, &last);
-	list_merge_sort(&first);
-	list_merge_sort(&last);
-	list_merge(self, &first, &last);
+int skip_list_get(const struct skip_list *self, size_t index) {
+	struct skip_list_node *node = skip_list_node_at(self, index);
+	if(node == NULL) return 0; // i out of bounds
+	return node->data;
+}
 
-	// Destroy
-	list_destroy(&first);
-	list_destroy(&last);
+void skip_list_set(struct skip_list *self, size_t index, int value) {
+	struct skip_list_node *node = skip_list_node_at(self, index);
+	if(node != NULL) node->data = value;
+}
+
+size_t skip_list_search(const struct skip_list *self, int value) {
+	const struct skip_list_link *links = self->head;
+	size_t rank = 0;
+	for(unsigned i = self->level; i-- > 0;) {
+		while(links[i].next != NULL && links[i].next->data < value) {
+			rank += links[i].span;
+			links = links[i].next->links;
+		}
+	}
+	// The next node is the first one not less than value, it has the index rank
+	if(links[0].next != NULL && links[0].next->data == value) return rank;
+	return self->size;
 }
 
-void tree_node_destroy(struct tree_node *node);
+bool skip_list_is_sorted(const struct skip_list *self) {
+	struct skip_list_node *curr = self->head[0].next;
+	if(curr == NULL) return true;
+	while(curr->links[0].next != NULL) {
+		if(curr->links[0].next->data < curr->data) return false;
+		curr = curr->links[0].next;
+	}
+	return true;
+}
+
+/*
+ * An AVL tree of n nodes is less than 1.45 * log2(n + 2) high, so this is enough
+ * for any tree that fits in memory and the operations never need to recurse
+ */
+#define TREE_MAX_HEIGHT 96
+
+void tree_node_destroy(const struct allocator *allocator, struct tree_node *node);
 
 /*
  * Create an empty tree
  */
 void tree_create(struct tree *self) {
+	tree_create_with(self, allocator_get_default());
+}
+
+/*
+ * Create an empty tree that gets its nodes from allocator
+ */
+void tree_create_with(struct tree *self, const struct allocator *allocator) {
 	self->root = NULL;
+	self->allocator = allocator;
 }
 
 /*
@@ -690,131 +2899,163 @@ void tree_create(struct tree *self) {
  */
 void tree_destroy(struct tree *self) {
 	if(self == NULL) return;
-	tree_node_destroy(self->root);
-	self = NULL;
+	tree_node_destroy(self->allocator, self->root);
+	self->root = NULL;
 }
 
-void tree_node_destroy(struct tree_node *node) {
-	if(node == NULL) return;
-	if(node->left != NULL) tree_node_destroy(node->left);
-	if(node->right != NULL) tree_node_destroy(node->right);
-	free(node);
+/*
+ * Free the nodes without a stack: rotate the left children up until the node
+ * has none, then it can be freed and we go on with its right child
+ */
+void tree_node_destroy(const struct allocator *allocator, struct tree_node *node) {
+	while(node != NULL) {
+		if(node->left != NULL) {
+			struct tree_node *left = node->left;
+			node->left = left->right;
+			left->right = node;
+			node = left;
+		} else {
+			struct tree_node *right = node->right;
+			allocator->deallocate(allocator->ctx, node, sizeof(struct tree_node));
+			node = right;
+		}
+	}
 }
 
-bool tree_contains_reccu(struct tree_node *node, int value) {
-	if(node == NULL) return false;
-	if(node->data == value) return true;
-
-	if(value < node->data) return(tree_contains_reccu(node->left, value));
-	if(value > node->data) return(tree_contains_reccu(node->right, value));
-	return false;
-}
 /*
  * Tell if a value is in the tree
  */
 bool tree_contains(const struct tree *self, int value) {
 	if(self == NULL) return false;
-	return tree_contains_reccu(self->root, value);
+	const struct tree_node *curr = self->root;
+	while(curr != NULL) {
+		if(value < curr->data) curr = curr->left;
+		else if(value > curr->data) curr = curr->right;
+		else return true;
+	}
+	return false;
 }
 
-struct tree_node* create_node(int value) {
-	struct tree_node *new_node = (struct tree_node*)malloc(sizeof(struct tree_node));
+struct tree_node* create_node(const struct allocator *allocator, int value) {
+	struct tree_node *new_node = (struct tree_node*)allocator->allocate(allocator->ctx, sizeof(struct tree_node));
 	if (new_node != NULL) {
 		new_node->data = value;
+		new_node->height = 1;
 		new_node->left = NULL;
 		new_node->right = NULL;
 	}
 	return new_node;
 }
 
-bool tree_insert_reccu(struct tree_node **node, int value) {
-	if (*node == NULL) {
-		*node = create_node(value);
-		return true; // Value insertedy
-	}
+static int tree_node_height(const struct tree_node *node) {
+	return node != NULL ? node->height : 0;
+}
+
+static void tree_node_update(struct tree_node *node) {
+	int left = tree_node_height(node->left);
+	int right = tree_node_height(node->right);
+	node->height = (left > right ? left : right) + 1;
+}
+
+static struct tree_node *tree_rotate_right(struct tree_node *node) {
+	struct tree_node *left = node->left;
+	node->left = left->right;
+	left->right = node;
+	tree_node_update(node);
+	tree_node_update(left);
+	return left;
+}
+
+static struct tree_node *tree_rotate_left(struct tree_node *node) {
+	struct tree_node *right = node->right;
+	node->right = right->left;
+	right->left = node;
+	tree_node_update(node);
+	tree_node_update(right);
+	return right;
+}
 
-	if (value < (*node)->data) {
-		return tree_insert_reccu(&((*node)->left), value);
-	} else if (value > (*node)->data) {
-		return tree_insert_reccu(&((*node)->right), value);
+/*
+ * Restore the AVL property of a node whose subtrees are balanced
+ */
+static void tree_rebalance(struct tree_node **node) {
+	struct tree_node *curr = *node;
+	int balance = tree_node_height(curr->left) - tree_node_height(curr->right);
+	if(balance > 1) {
+		if(tree_node_height(curr->left->left) < tree_node_height(curr->left->right)) {
+			curr->left = tree_rotate_left(curr->left);
+		}
+		*node = tree_rotate_right(curr);
+	} else if(balance < -1) {
+		if(tree_node_height(curr->right->right) < tree_node_height(curr->right->left)) {
+			curr->right = tree_rotate_right(curr->right);
+		}
+		*node = tree_rotate_left(curr);
 	} else {
-		return false; // Value present
+		tree_node_update(curr);
 	}
 }
 
 /*
- * Insert a value in the tree and return false if the value was already present
+ * Rebalance the nodes of a path from the deepest one up to the root
+ * The links stay valid as rotations only change the nodes below them
  */
-bool tree_insert(struct tree *self, int value) {
-	return tree_insert_reccu(&(self->root), value);
-}
-
-struct tree_node *findMin(struct tree_node *self) {
-	struct tree_node *min = self;
-	while(min->left != NULL) min = min->left;
-	return min;
-}
-
-struct tree_node *findMax(struct tree_node *self) {
-	struct tree_node *max = self;
-	while(max->right != NULL) max = max->right;
-	return max;
-}
-
-void replaceNode(struct tree_node *oldNode, struct tree_node *newNode) {
-    if (oldNode->left == NULL && oldNode->right == NULL) {
-        // If oldNode is a leaf node, set tree's root to NULL
-        // Not sure if this is the desired behavior. You might want to adjust it based on your requirements.
-        oldNode = NULL;
-    } else if (oldNode->left == NULL) {
-        // If oldNode has no left child, replace it with its right child
-        oldNode->data = oldNode->right->data;
-        replaceNode(oldNode->right, newNode);
-    } else if (oldNode->right == NULL) {
-        // If oldNode has no right child, replace it with its left child
-        oldNode->data = oldNode->left->data;
-        replaceNode(oldNode->left, newNode);
-    }
-    // Adjust other pointers as needed
+static void tree_rebalance_path(struct tree_node ***path, size_t depth) {
+	while(depth > 0) {
+		tree_rebalance(path[--depth]);
+	}
 }
 
-bool tree_remove_reccu(struct tree_node **root, int value) {
-    if (*root == NULL) {
-        return false; // Value not found
-    }
-
-    if (value > (*root)->data) {
-        return tree_remove_reccu(&(*root)->right, value);
-    } else if (value < (*root)->data) {
-        return tree_remove_reccu(&(*root)->left, value);
-    }
-
-    // Value found, perform removal
-    if ((*root)->left == NULL) {
-        // Replace the current node with its right child
-        struct tree_node *temp = (*root)->right;
-        free(*root);
-        *root = temp;
-    } else if ((*root)->right == NULL) {
-        // Replace the current node with its left child
-        struct tree_node *temp = (*root)->left;
-        free(*root);
-        *root = temp;
-    } else {
-        // Case 2: Node with two children
-        // Get the in-order successor (minimum in the right subtree)
-        struct tree_node *successor = findMin((*root)->right);
-        // Copy the in-order successor's value to this node
-        (*root)->data = successor->data;
-        // Remove the in-order successor
-        tree_remove_reccu(&(*root)->right, successor->data);
-    }
-
-    return true;
+/*
+ * Insert a value in the tree and return false if the value was already present
+ */
+bool tree_insert(struct tree *self, int value) {
+	struct tree_node **path[TREE_MAX_HEIGHT];
+	size_t depth = 0;
+	struct tree_node **link = &self->root;
+	while(*link != NULL) {
+		if(value == (*link)->data) return false; // Value present
+		path[depth++] = link;
+		link = value < (*link)->data ? &(*link)->left : &(*link)->right;
+	}
+	*link = create_node(self->allocator, value);
+	if(*link == NULL) return false;
+	tree_rebalance_path(path, depth);
+	return true;
 }
 
+/*
+ * Remove a value from the tree and return false if the value was not present
+ */
 bool tree_remove(struct tree *self, int value) {
-    return tree_remove_reccu(&(self->root), value);
+	struct tree_node **path[TREE_MAX_HEIGHT];
+	size_t depth = 0;
+	struct tree_node **link = &self->root;
+	while(*link != NULL && (*link)->data != value) {
+		path[depth++] = link;
+		link = value < (*link)->data ? &(*link)->left : &(*link)->right;
+	}
+	if(*link == NULL) return false; // Value not found
+
+	struct tree_node *node = *link;
+	if(node->left != NULL && node->right != NULL) {
+		// Node with two children, it takes the value of its in-order successor
+		// (the minimum of the right subtree) which is removed instead
+		path[depth++] = link;
+		link = &node->right;
+		while((*link)->left != NULL) {
+			path[depth++] = link;
+			link = &(*link)->left;
+		}
+		struct tree_node *successor = *link;
+		node->data = successor->data;
+		node = successor;
+	}
+	// The node has at most one child, which replaces it
+	*link = node->left != NULL ? node->left : node->right;
+	self->allocator->deallocate(self->allocator->ctx, node, sizeof(struct tree_node));
+	tree_rebalance_path(path, depth);
+	return true;
 }
 
 
@@ -829,8 +3070,18 @@ bool tree_empty(const struct tree *self) {
  * Get the size of the tree
  */
 size_t node_size(const struct tree_node *self) {
-	if(self == NULL) return 0; 
-	return 1 + node_size(self->left) + node_size(self->right);
+	const struct tree_node *stack[TREE_MAX_HEIGHT];
+	size_t top = 0;
+	size_t size = 0;
+	const struct tree_node *curr = self;
+	while(curr != NULL || top > 0) {
+		if(curr == NULL) curr = stack[--top];
+		size++;
+		// Go on with the left child, the right one will be counted later
+		if(curr->right != NULL) stack[top++] = curr->right;
+		curr = curr->left;
+	}
+	return size;
 }
 
 size_t tree_size(const struct tree *self) {
@@ -839,13 +3090,7 @@ size_t tree_size(const struct tree *self) {
 }
 
 size_t node_height(const struct tree_node *node) {
-	if(node == NULL) return 0;
-
-	size_t sizeLeft = node_height(node->left);
-	size_t sizeRight = node_height(node->right);
-	
-	if(sizeLeft > sizeRight) return sizeLeft + 1;
-	return sizeRight + 1;
+	return tree_node_height(node); // Kept up to date by the balancing
 }
 /*
  * Get the height of the tree
@@ -856,31 +3101,450 @@ size_t tree_height(const struct tree *self) {
 }
 
 
-void tree_walk_pre_order_reccu(const struct tree_node *self, tree_func_t func, void *user_data) {
-	func(self->data, user_data);
-	if(self->right != NULL) tree_walk_pre_order_reccu(self->right, func, user_data);
-	if(self->left != NULL) tree_walk_pre_order_reccu(self->left, func, user_data);
+void tree_walk_pre_order(const struct tree *self, tree_func_t func, void *user_data)  {
+	const struct tree_node *stack[TREE_MAX_HEIGHT + 1];
+	size_t top = 0;
+	if(self->root != NULL) stack[top++] = self->root;
+	while(top > 0) {
+		const struct tree_node *curr = stack[--top];
+		func(curr->data, user_data);
+		// The right subtree is walked first
+		if(curr->left != NULL) stack[top++] = curr->left;
+		if(curr->right != NULL) stack[top++] = curr->right;
+	}
+}
+
+void tree_walk_in_order(const struct tree *self, tree_func_t func, void *user_data) {
+	const struct tree_node *stack[TREE_MAX_HEIGHT];
+	size_t top = 0;
+	const struct tree_node *curr = self->root;
+	while(curr != NULL || top > 0) {
+		// Go down to the leftmost node, keeping the way back
+		while(curr != NULL) {
+			stack[top++] = curr;
+			curr = curr->left;
+		}
+		curr = stack[--top];
+		func(curr->data, user_data);
+		curr = curr->right;
+	}
 }
 
-void tree_walk_pre_order(const struct tree *self, tree_func_t func, void *user_data)  {
-	tree_walk_pre_order_reccu(self->root, func, user_data);
+void tree_walk_post_order(const struct tree *self, tree_func_t func, void *user_data) {
+	const struct tree_node *stack[TREE_MAX_HEIGHT];
+	size_t top = 0;
+	const struct tree_node *curr = self->root;
+	const struct tree_node *last = NULL; // Last node given to func
+	while(curr != NULL || top > 0) {
+		while(curr != NULL) {
+			stack[top++] = curr;
+			curr = curr->left;
+		}
+		const struct tree_node *parent = stack[top - 1];
+		if(parent->right != NULL && parent->right != last) {
+			// The right subtree is not done yet
+			curr = parent->right;
+		} else {
+			func(parent->data, user_data);
+			last = parent;
+			top--;
+		}
+	}
 }
 
-void tree_walk_in_order_reccu(const struct tree_node *self, tree_func_t func, void *user_data) {
-	if(self->left != NULL)	tree_walk_in_order_reccu(self->left, func, user_data);
-	func(self->data, user_data);
-	if(self->right != NULL)	tree_walk_in_order_reccu(self->right, func, user_data);
+/*
+ * All the nodes of a B+-tree have the same size, the leaves and the inner nodes
+ * only differ by the content of the union. The leaves are at depth height - 1.
+ */
+#define BPTREE_LEAF_CAPACITY ((BPTREE_NODE_SIZE - 2 * sizeof(void *)) / sizeof(int))
+#define BPTREE_INNER_CAPACITY ((BPTREE_NODE_SIZE - 2 * sizeof(void *)) / (sizeof(int) + sizeof(void *)))
+#define BPTREE_LEAF_MIN (BPTREE_LEAF_CAPACITY / 2)
+#define BPTREE_INNER_MIN (BPTREE_INNER_CAPACITY / 2)
+#define BPTREE_MAX_HEIGHT 32
+
+struct bptree_node {
+	unsigned count; // Number of keys
+	union {
+		struct {
+			struct bptree_node *next;
+			int keys[BPTREE_LEAF_CAPACITY];
+		} leaf;
+		struct {
+			int keys[BPTREE_INNER_CAPACITY]; // keys[i] separates children[i] (less) and children[i + 1]
+			struct bptree_node *children[BPTREE_INNER_CAPACITY + 1];
+		} inner;
+	} u;
+};
+
+typedef char bptree_node_fits[sizeof(struct bptree_node) <= BPTREE_NODE_SIZE ? 1 : -1];
+
+/*
+ * Count the keys less than value, or less or equal if inclusive
+ * The keys are sorted so this is the position of value
+ */
+static unsigned bptree_rank(const int *keys, unsigned count, int value, bool inclusive) {
+	unsigned i = 0;
+	unsigned rank = 0;
+#if ARRAY_SIMD_X86
+	__m128i needle = _mm_set1_epi32(value);
+	for(; i + 4 <= count; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(keys + i));
+		if(inclusive) {
+			int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, needle)));
+			rank += 4 - __builtin_popcount(mask);
+		} else {
+			int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(needle, v)));
+			rank += __builtin_popcount(mask);
+		}
+	}
+#endif
+	for(; i < count; i++) {
+		if(keys[i] < value || (inclusive && keys[i] == value)) rank++;
+	}
+	return rank;
 }
 
-void tree_walk_in_order(const struct tree *self, tree_func_t func, void *user_data) {
-	tree_walk_in_order_reccu(self->root, func, user_data);
+static struct bptree_node *bptree_node_create(struct bptree *self) {
+	struct bptree_node *node = self->allocator->allocate(self->allocator->ctx, sizeof(struct bptree_node));
+	if(node == NULL) {
+		printf("Allocation error");
+		return NULL;
+	}
+	node->count = 0;
+	return node;
 }
 
-void tree_walk_post_order_reccu(const struct tree_node *self, tree_func_t func, void *user_data) {
-	if(self->left != NULL)	tree_walk_post_order_reccu(self->left, func, user_data);
-	if(self->right != NULL)	tree_walk_post_order_reccu(self->right, func, user_data);
-	func(self->data, user_data);
+static void bptree_node_free(struct bptree *self, struct bptree_node *node) {
+	self->allocator->deallocate(self->allocator->ctx, node, sizeof(struct bptree_node));
 }
-void tree_walk_post_order(const struct tree *self, tree_func_t func, void *user_data) {
-	tree_walk_post_order_reccu(self->root, func, user_data);
+
+/*
+ * Create an empty B+-tree
+ */
+void bptree_create(struct bptree *self) {
+	bptree_create_with(self, allocator_get_default());
+}
+
+/*
+ * Create an empty B+-tree that gets its nodes from allocator
+ */
+void bptree_create_with(struct bptree *self, const struct allocator *allocator) {
+	self->root = NULL;
+	self->size = 0;
+	self->height = 0;
+	self->allocator = allocator;
+}
+
+/*
+ * Destroy a B+-tree, the nodes are freed after their children
+ */
+void bptree_destroy(struct bptree *self) {
+	if(self == NULL) return;
+	struct bptree_node *stack[BPTREE_MAX_HEIGHT];
+	unsigned next[BPTREE_MAX_HEIGHT]; // Next child to visit
+	unsigned top = 0;
+	if(self->root != NULL) {
+		stack[0] = self->root;
+		next[0] = 0;
+		top = 1;
+	}
+	while(top > 0) {
+		struct bptree_node *node = stack[top - 1];
+		// The node at the top is at depth top - 1, it is an inner node if top < height
+		if(top < self->height && next[top - 1] <= node->count) {
+			stack[top] = node->u.inner.children[next[top - 1]++];
+			next[top] = 0;
+			top++;
+		} else {
+			bptree_node_free(self, node);
+			top--;
+		}
+	}
+	bptree_create_with(self, self->allocator);
+}
+
+bool bptree_empty(const struct bptree *self) {
+	return self->size == 0;
+}
+
+size_t bptree_size(const struct bptree *self) {
+	return self->size;
+}
+
+/*
+ * Go down to the leaf that may hold value
+ */
+static struct bptree_node *bptree_find_leaf(const struct bptree *self, int value) {
+	struct bptree_node *node = self->root;
+	for(unsigned level = 1; level < self->height; level++) {
+		node = node->u.inner.children[bptree_rank(node->u.inner.keys, node->count, value, true)];
+	}
+	return node;
+}
+
+bool bptree_contains(const struct bptree *self, int value) {
+	if(self == NULL || self->root == NULL) return false;
+	struct bptree_node *leaf = bptree_find_leaf(self, value);
+	unsigned pos = bptree_rank(leaf->u.leaf.keys, leaf->count, value, false);
+	return pos < leaf->count && leaf->u.leaf.keys[pos] == value;
+}
+
+/*
+ * Insert key and its right child at pos in an inner node, splitting the node into spare if it is full
+ * Return the new right node (and the key to insert in the parent in up) or NULL if no split
+ */
+static struct bptree_node *bptree_inner_insert(struct bptree_node *node, unsigned pos, int key, struct bptree_node *child, struct bptree_node *spare, int *up) {
+	int keys[BPTREE_INNER_CAPACITY + 1];
+	struct bptree_node *children[BPTREE_INNER_CAPACITY + 2];
+	unsigned count = node->count;
+	if(count < BPTREE_INNER_CAPACITY) {
+		memmove(node->u.inner.keys + pos + 1, node->u.inner.keys + pos, (count - pos) * sizeof(int));
+		memmove(node->u.inner.children + pos + 2, node->u.inner.children + pos + 1, (count - pos) * sizeof(struct bptree_node *));
+		node->u.inner.keys[pos] = key;
+		node->u.inner.children[pos + 1] = child;
+		node->count++;
+		return NULL;
+	}
+
+	struct bptree_node *right = spare;
+	memcpy(keys, node->u.inner.keys, pos * sizeof(int));
+	keys[pos] = key;
+	memcpy(keys + pos + 1, node->u.inner.keys + pos, (count - pos) * sizeof(int));
+	memcpy(children, node->u.inner.children, (pos + 1) * sizeof(struct bptree_node *));
+	children[pos + 1] = child;
+	memcpy(children + pos + 2, node->u.inner.children + pos + 1, (count - pos) * sizeof(struct bptree_node *));
+
+	// The middle key goes up, the others are shared between the two nodes
+	unsigned mid = (count + 1) / 2;
+	node->count = mid;
+	memcpy(node->u.inner.keys, keys, mid * sizeof(int));
+	memcpy(node->u.inner.children, children, (mid + 1) * sizeof(struct bptree_node *));
+	right->count = count - mid;
+	memcpy(right->u.inner.keys, keys + mid + 1, right->count * sizeof(int));
+	memcpy(right->u.inner.children, children + mid + 1, (right->count + 1) * sizeof(struct bptree_node *));
+	*up = keys[mid];
+	return right;
+}
+
+bool bptree_insert(struct bptree *self, int value) {
+	if(self->root == NULL) {
+		self->root = bptree_node_create(self);
+		if(self->root == NULL) return false;
+		self->root->u.leaf.next = NULL;
+		self->height = 1;
+	}
+
+	// Go down to the leaf, keeping the way back
+	struct bptree_node *path[BPTREE_MAX_HEIGHT];
+	unsigned index[BPTREE_MAX_HEIGHT];
+	struct bptree_node *node = self->root;
+	for(unsigned level = 0; level + 1 < self->height; level++) {
+		path[level] = node;
+		index[level] = bptree_rank(node->u.inner.keys, node->count, value, true);
+		node = node->u.inner.children[index[level]];
+	}
+
+	unsigned pos = bptree_rank(node->u.leaf.keys, node->count, value, false);
+	if(pos < node->count && node->u.leaf.keys[pos] == value) return false; // Value present
+
+	// Allocate all the nodes the splits need before changing anything:
+	// the leaf, the full parents above it and a new root if they are all full
+	struct bptree_node *spare[BPTREE_MAX_HEIGHT + 1];
+	unsigned needed = 0;
+	if(node->count == BPTREE_LEAF_CAPACITY) {
+		needed = 1;
+		unsigned level = self->height - 1;
+		while(level > 0 && path[level - 1]->count == BPTREE_INNER_CAPACITY) {
+			needed++;
+			level--;
+		}
+		if(level == 0) needed++;
+	}
+	for(unsigned i = 0; i < needed; i++) {
+		spare[i] = bptree_node_create(self);
+		if(spare[i] == NULL) {
+			while(i-- > 0) bptree_node_free(self, spare[i]);
+			return false;
+		}
+	}
+	unsigned used = 0;
+
+	struct bptree_node *right = NULL;
+	int up = 0;
+	if(node->count == BPTREE_LEAF_CAPACITY) {
+		// Split the leaf, the upper half goes in a new leaf linked after it
+		right = spare[used++];
+		unsigned half = node->count / 2;
+		right->count = node->count - half;
+		memcpy(right->u.leaf.keys, node->u.leaf.keys + half, right->count * sizeof(int));
+		right->u.leaf.next = node->u.leaf.next;
+		node->u.leaf.next = right;
+		node->count = half;
+		if(pos > half) {
+			pos -= half;
+			node = right;
+		}
+	}
+	memmove(node->u.leaf.keys + pos + 1, node->u.leaf.keys + pos, (node->count - pos) * sizeof(int));
+	node->u.leaf.keys[pos] = value;
+	node->count++;
+	self->size++;
+	if(right != NULL) up = right->u.leaf.keys[0];
+
+	// Give the new nodes to the parents
+	for(unsigned level = self->height - 1; right != NULL && level-- > 0;) {
+		struct bptree_node *parent = path[level];
+		right = bptree_inner_insert(parent, index[level], up, right, parent->count == BPTREE_INNER_CAPACITY ? spare[used++] : NULL, &up);
+	}
+	if(right != NULL) {
+		// The root was split, the tree grows by the top
+		struct bptree_node *root = spare[used++];
+		root->count = 1;
+		root->u.inner.keys[0] = up;
+		root->u.inner.children[0] = self->root;
+		root->u.inner.children[1] = right;
+		self->root = root;
+		self->height++;
+	}
+	return true;
+}
+
+/*
+ * Remove the key pos and the child at its right from an inner node
+ */
+static void bptree_inner_erase(struct bptree_node *node, unsigned pos) {
+	node->count--;
+	memmove(node->u.inner.keys + pos, node->u.inner.keys + pos + 1, (node->count - pos) * sizeof(int));
+	memmove(node->u.inner.children + pos + 1, node->u.inner.children + pos + 2, (node->count - pos) * sizeof(struct bptree_node *));
+}
+
+/*
+ * Refill the child i of parent, which is a leaf if leaf is true, from one of its siblings
+ * Either a key is borrowed or the child is merged with a sibling
+ */
+static void bptree_fix_underflow(struct bptree *self, struct bptree_node *parent, unsigned i, bool leaf) {
+	unsigned min = leaf ? BPTREE_LEAF_MIN : BPTREE_INNER_MIN;
+	struct bptree_node *node = parent->u.inner.children[i];
+	struct bptree_node *left = i > 0 ? parent->u.inner.children[i - 1] : NULL;
+	struct bptree_node *right = i < parent->count ? parent->u.inner.children[i + 1] : NULL;
+
+	if(left != NULL && left->count > min) {
+		// Borrow the last key of the left sibling
+		if(leaf) {
+			memmove(node->u.leaf.keys + 1, node->u.leaf.keys, node->count * sizeof(int));
+			node->u.leaf.keys[0] = left->u.leaf.keys[left->count - 1];
+			parent->u.inner.keys[i - 1] = node->u.leaf.keys[0];
+		} else {
+			memmove(node->u.inner.keys + 1, node->u.inner.keys, node->count * sizeof(int));
+			memmove(node->u.inner.children + 1, node->u.inner.children, (node->count + 1) * sizeof(struct bptree_node *));
+			node->u.inner.keys[0] = parent->u.inner.keys[i - 1];
+			node->u.inner.children[0] = left->u.inner.children[left->count];
+			parent->u.inner.keys[i - 1] = left->u.inner.keys[left->count - 1];
+		}
+		left->count--;
+		node->count++;
+		return;
+	}
+	if(right != NULL && right->count > min) {
+		// Borrow the first key of the right sibling
+		if(leaf) {
+			node->u.leaf.keys[node->count] = right->u.leaf.keys[0];
+			memmove(right->u.leaf.keys, right->u.leaf.keys + 1, (right->count - 1) * sizeof(int));
+			parent->u.inner.keys[i] = right->u.leaf.keys[0];
+		} else {
+			node->u.inner.keys[node->count] = parent->u.inner.keys[i];
+			node->u.inner.children[node->count + 1] = right->u.inner.children[0];
+			parent->u.inner.keys[i] = right->u.inner.keys[0];
+			memmove(right->u.inner.keys, right->u.inner.keys + 1, (right->count - 1) * sizeof(int));
+			memmove(right->u.inner.children, right->u.inner.children + 1, right->count * sizeof(struct bptree_node *));
+		}
+		right->count--;
+		node->count++;
+		return;
+	}
+
+	// Merge with a sibling, the right node of the pair goes into the left one
+	if(left == NULL) {
+		left = node;
+		i++;
+	} else {
+		right = node;
+	}
+	if(leaf) {
+		memcpy(left->u.leaf.keys + left->count, right->u.leaf.keys, right->count * sizeof(int));
+		left->count += right->count;
+		left->u.leaf.next = right->u.leaf.next;
+	} else {
+		left->u.inner.keys[left->count] = parent->u.inner.keys[i - 1];
+		memcpy(left->u.inner.keys + left->count + 1, right->u.inner.keys, right->count * sizeof(int));
+		memcpy(left->u.inner.children + left->count + 1, right->u.inner.children, (right->count + 1) * sizeof(struct bptree_node *));
+		left->count += right->count + 1;
+	}
+	bptree_node_free(self, right);
+	bptree_inner_erase(parent, i - 1);
+}
+
+bool bptree_remove(struct bptree *self, int value) {
+	if(self->root == NULL) return false;
+
+	struct bptree_node *path[BPTREE_MAX_HEIGHT];
+	unsigned index[BPTREE_MAX_HEIGHT];
+	struct bptree_node *node = self->root;
+	for(unsigned level = 0; level + 1 < self->height; level++) {
+		path[level] = node;
+		index[level] = bptree_rank(node->u.inner.keys, node->count, value, true);
+		node = node->u.inner.children[index[level]];
+	}
+
+	unsigned pos = bptree_rank(node->u.leaf.keys, node->count, value, false);
+	if(pos == node->count || node->u.leaf.keys[pos] != value) return false; // Value not found
+	node->count--;
+	memmove(node->u.leaf.keys + pos, node->u.leaf.keys + pos + 1, (node->count - pos) * sizeof(int));
+	self->size--;
+
+	// Go back up while the nodes are less than half full
+	for(unsigned level = self->height - 1; level-- > 0;) {
+		struct bptree_node *child = path[level]->u.inner.children[index[level]];
+		unsigned min = level + 2 == self->height ? BPTREE_LEAF_MIN : BPTREE_INNER_MIN;
+		if(child->count >= min) break;
+		bptree_fix_underflow(self, path[level], index[level], level + 2 == self->height);
+	}
+
+	// The root may be left empty
+	if(self->root->count == 0) {
+		struct bptree_node *root = self->root;
+		self->root = self->height > 1 ? root->u.inner.children[0] : NULL;
+		self->height--;
+		bptree_node_free(self, root);
+	}
+	return true;
+}
+
+static const struct bptree_node *bptree_first_leaf(const struct bptree *self) {
+	const struct bptree_node *node = self->root;
+	for(unsigned level = 1; level < self->height; level++) {
+		node = node->u.inner.children[0];
+	}
+	return node;
+}
+
+void bptree_walk_in_order(const struct bptree *self, tree_func_t func, void *user_data) {
+	if(self->root == NULL) return;
+	for(const struct bptree_node *leaf = bptree_first_leaf(self); leaf != NULL; leaf = leaf->u.leaf.next) {
+		for(unsigned i = 0; i < leaf->count; i++) {
+			func(leaf->u.leaf.keys[i], user_data);
+		}
+	}
+}
+
+void bptree_walk_range(const struct bptree *self, int low, int high, tree_func_t func, void *user_data) {
+	if(self->root == NULL || low > high) return;
+	const struct bptree_node *leaf = bptree_find_leaf(self, low);
+	unsigned i = bptree_rank(leaf->u.leaf.keys, leaf->count, low, false);
+	for(; leaf != NULL; leaf = leaf->u.leaf.next, i = 0) {
+		for(; i < leaf->count; i++) {
+			if(leaf->u.leaf.keys[i] > high) return;
+			func(leaf->u.leaf.keys[i], user_data);
+		}
+	}
 }
@@ -8,17 +8,134 @@
 extern "C" {
 #endif
 
+/*
+ * A memory allocator used by the containers. Every function gets ctx as its
+ * first argument, and the size of a block is given back when it is resized
+ * or freed, so an allocator does not need to store it.
+ */
+struct allocator {
+  void *(*allocate)(void *ctx, size_t size);
+  void *(*reallocate)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+  void (*deallocate)(void *ctx, void *ptr, size_t size);
+  void *ctx;
+};
+
+/*
+ * The allocator based on malloc, realloc and free
+ */
+extern const struct allocator allocator_system;
+
+/*
+ * An allocator that keeps small freed blocks in a per-thread cache for reuse
+ */
+extern const struct allocator allocator_thread_cache;
+
+/*
+ * Set the allocator used by the containers created without one (NULL for allocator_system)
+ * Should be done before any container is created
+ */
+void allocator_set_default(const struct allocator *allocator);
+
+/*
+ * Get the allocator used by the containers created without one
+ */
+const struct allocator *allocator_get_default(void);
+
+struct arena_chunk;
+
+/*
+ * A bump allocator: blocks are carved one after the other in big chunks and
+ * are all given back at once by arena_reset
+ */
+struct arena {
+  struct arena_chunk *chunks;
+  size_t chunk_size;
+  void *last;
+};
+
+/*
+ * Create an empty arena that allocates chunks of chunk_size bytes
+ */
+void arena_create(struct arena *self, size_t chunk_size);
+
+/*
+ * Destroy an arena and all the memory allocated from it
+ */
+void arena_destroy(struct arena *self);
+
+/*
+ * Give back all the memory allocated from the arena at once
+ * The containers using the arena must not be used (or destroyed) afterwards
+ */
+void arena_reset(struct arena *self);
+
+/*
+ * Get an allocator that allocates from the arena
+ */
+void arena_allocator(struct arena *self, struct allocator *allocator);
+
+/*
+ * Number of elements stored inside struct array itself before using the heap
+ */
+#define ARRAY_SMALL_CAPACITY 16
+
+/*
+ * Capacity of a newly created array
+ */
+#define ARRAY_INITIAL_CAPACITY ARRAY_SMALL_CAPACITY
+
+/*
+ * Default factor applied to the capacity when the array is full
+ */
+#define ARRAY_DEFAULT_GROWTH_FACTOR 2.0
+
+/*
+ * Default number of children of a node when the array is used as a heap
+ */
+#define ARRAY_DEFAULT_HEAP_ARITY 2
+
+/*
+ * While capacity is ARRAY_SMALL_CAPACITY, data points to inline_data, so an
+ * array must not be copied with = (use array_create_from instead)
+ */
 struct array {
   int *data;
   size_t capacity;
   size_t size;
+  double growth_factor;
+  size_t heap_arity;
+  const struct allocator *allocator;
+  int inline_data[ARRAY_SMALL_CAPACITY];
+};
+
+/*
+ * The kernels used by array_equals, array_search and array_is_sorted.
+ * By default the best one supported by the CPU is picked at runtime.
+ */
+enum array_simd {
+  ARRAY_SIMD_AUTO,
+  ARRAY_SIMD_SCALAR,
+  ARRAY_SIMD_SSE2,
+  ARRAY_SIMD_AVX2,
 };
 
+/*
+ * Force a kernel level, so that each one can be tested on any machine
+ * A level the CPU does not support falls back to the best supported one
+ * Not thread safe, should be done while no array is scanned
+ */
+void array_set_simd(enum array_simd level);
+
 /*
  * Create an empty array
  */
 void array_create(struct array *self);
 
+/*
+ * Create an empty array that gets its memory from allocator
+ */
+void array_create_with(struct array *self, const struct allocator *allocator);
+
 /*
  * Create an array with initial content
  */
@@ -29,6 +146,22 @@ void array_create_from(struct array *self, const int *other, size_t size);
  */
 void array_destroy(struct array *self);
 
+/*
+ * Set the factor used to grow the capacity of the array (must be finite and greater than 1)
+ */
+void array_set_growth_factor(struct array *self, double factor);
+
+/*
+ * Make sure the array can hold at least capacity elements without reallocation
+ */
+void array_reserve(struct array *self, size_t capacity);
+
+/*
+ * Reduce the capacity of the array to its size, but not below ARRAY_SMALL_CAPACITY
+ * (the inline buffer is always there)
+ */
+void array_shrink_to_fit(struct array *self);
+
 /*
  * Tell if the array is empty
  */
@@ -64,6 +197,29 @@ void array_insert(struct array *self, int value, size_t index);
  */
 void array_remove(struct array *self, size_t index);
 
+/*
+ * Replace the content of the array with size elements from other
+ * other must not point inside the array
+ */
+void array_assign(struct array *self, const int *other, size_t size);
+
+/*
+ * Add size elements from other at the end of the array
+ * other must not point inside the array
+ */
+void array_append_range(struct array *self, const int *other, size_t size);
+
+/*
+ * Insert size elements from other in the array at index (preserving the order)
+ * other must not point inside the array
+ */
+void array_insert_range(struct array *self, const int *other, size_t size, size_t index);
+
+/*
+ * Remove count elements from the array starting at index (preserving the order)
+ */
+void array_remove_range(struct array *self, size_t index, size_t count);
+
 /*
  * Get an element at the specified index in the array, or 0 if the index is not valid
  */
@@ -84,6 +240,11 @@ size_t array_search(const struct array *self, int value);
  */
 size_t array_search_sorted(const struct array *self, int value);
 
+/*
+ * Search for n keys in the sorted array, out[i] receives the same result as array_search_sorted(self, keys[i])
+ */
+void array_search_sorted_batch(const struct array *self, const int *keys, size_t n, size_t *out);
+
 /*
  * Tell if the array is sorted
  */
@@ -99,11 +260,43 @@ ptrdiff_t array_partition(struct array *self, ptrdiff_t i, ptrdiff_t j);
  */
 void array_quick_sort(struct array *self);
 
+/*
+ * Sort the array with a LSD radix sort (11 bits per pass)
+ */
+void array_radix_sort(struct array *self);
+
+/*
+ * Sort the array with a LSD radix sort, using scratch as temporary storage
+ * scratch is grown if needed and can be reused between calls
+ */
+void array_radix_sort_with(struct array *self, struct array *scratch);
+
+/*
+ * Sort the array with a parallel sample sort using up to threads threads
+ * Small arrays are sorted sequentially with array_quick_sort
+ */
+void array_parallel_sort(struct array *self, unsigned threads);
+
+/*
+ * Same as array_parallel_sort, and store in bucket_sizes (room for threads values,
+ * nothing is stored if threads is 0) how many values each thread sorted in the
+ * last phase, to check the balance
+ */
+void array_parallel_sort_profile(struct array *self, unsigned threads, size_t *bucket_sizes);
+
 /*
  * Sort the array with heap sort
  */
 void array_heap_sort(struct array *self);
 
+/*
+ * Set the number of children of a node when the array is used as a heap (at least 2)
+ * 4 or 8 make the heap shallower and scan the children of a node contiguously
+ * (the root is data[0], so a group of children may still straddle two cache lines)
+ * The content is not reorganized, so this should be done while the array is empty
+ */
+void array_set_heap_arity(struct array *self, size_t arity);
+
 /*
  * Tell if the array is a heap
  */
@@ -114,6 +307,16 @@ bool array_is_heap(const struct array *self);
  */
 void array_heap_add(struct array *self, int value);
 
+/*
+ * Reorganize the content of the array into a heap in O(n)
+ */
+void array_heap_build(struct array *self);
+
+/*
+ * Add size values from other into the array considered as a heap
+ */
+void array_heap_add_bulk(struct array *self, const int *other, size_t size);
+
 /*
  * Get the value at the top of the heap
  */
@@ -125,6 +328,127 @@ int array_heap_top(const struct array *self);
 void array_heap_remove_top(struct array *self);
 
 
+/*
+ * A read-only copy of a sorted array in Eytzinger (breadth-first) order,
+ * for fast lookups. data and rank are indexed from 1, rank[k] is the index
+ * of data[k] in the sorted array. Both live in one block from allocator.
+ */
+struct eytzinger {
+  int *data;
+  size_t *rank;
+  size_t size;
+  void *block;
+  size_t block_size;
+  const struct allocator *allocator;
+};
+
+/*
+ * Build an Eytzinger index from a sorted array, with the allocator of the array
+ */
+void array_build_eytzinger(const struct array *self, struct eytzinger *index);
+
+/*
+ * Destroy an Eytzinger index
+ */
+void eytzinger_destroy(struct eytzinger *index);
+
+/*
+ * Get the index in the sorted array of the first element greater or equal to value, or the size if there is none
+ */
+size_t eytzinger_lower_bound(const struct eytzinger *index, int value);
+
+/*
+ * Search for an element and return its index in the sorted array, or the size if not present
+ */
+size_t eytzinger_search(const struct eytzinger *index, int value);
+
+
+/*
+ * Handle value telling that a position is not used
+ */
+#define INDEXED_HEAP_NONE ((size_t) -1)
+
+/*
+ * A max heap of handles ordered by their priority, where a handle can be
+ * found, reprioritized and removed in O(log n). Handles are chosen by the
+ * caller (e.g. vertex numbers); position[handle] is the index of the handle
+ * in heap or INDEXED_HEAP_NONE.
+ */
+struct indexed_heap {
+  size_t *heap;
+  size_t *position;
+  int *priority;
+  size_t size;
+  size_t capacity;
+  const struct allocator *allocator;
+};
+
+/*
+ * Create an empty indexed heap
+ */
+void indexed_heap_create(struct indexed_heap *self);
+
+/*
+ * Create an empty indexed heap that gets its memory from allocator
+ */
+void indexed_heap_create_with(struct indexed_heap *self, const struct allocator *allocator);
+
+/*
+ * Destroy an indexed heap
+ */
+void indexed_heap_destroy(struct indexed_heap *self);
+
+/*
+ * Tell if the indexed heap is empty
+ */
+bool indexed_heap_empty(const struct indexed_heap *self);
+
+/*
+ * Get the number of handles in the indexed heap
+ */
+size_t indexed_heap_size(const struct indexed_heap *self);
+
+/*
+ * Tell if a handle is in the indexed heap
+ */
+bool indexed_heap_contains(const struct indexed_heap *self, size_t handle);
+
+/*
+ * Add a handle with a priority and return false if the handle was already present
+ * INDEXED_HEAP_NONE is not a valid handle
+ */
+bool indexed_heap_push(struct indexed_heap *self, size_t handle, int priority);
+
+/*
+ * Get the handle with the highest priority
+ */
+size_t indexed_heap_top(const struct indexed_heap *self);
+
+/*
+ * Get the priority of a handle, or 0 if the handle is not present
+ */
+int indexed_heap_priority(const struct indexed_heap *self, size_t handle);
+
+/*
+ * Remove the handle with the highest priority
+ */
+void indexed_heap_pop(struct indexed_heap *self);
+
+/*
+ * Remove a handle and return false if the handle was not present
+ */
+bool indexed_heap_remove(struct indexed_heap *self, size_t handle);
+
+/*
+ * Lower the priority of a handle and return false if the handle was not present or the priority is higher
+ */
+bool indexed_heap_decrease_key(struct indexed_heap *self, size_t handle, int priority);
+
+/*
+ * Raise the priority of a handle and return false if the handle was not present or the priority is lower
+ */
+bool indexed_heap_increase_key(struct indexed_heap *self, size_t handle, int priority);
+
 
 struct list_node {
   int data;
@@ -132,9 +456,25 @@ struct list_node {
   struct list_node *prev;
 };
 
+/*
+ * Nodes of a list are carved from big chunks owned by the list, and recycled
+ * through a free list. The pool is created with the first node.
+ *
+ * list_split and list_merge relink the nodes instead of copying them, so the
+ * lists involved end up sharing one pool (it is reference counted). The chunks
+ * are only freed when the last of these lists is destroyed: destroying one of
+ * them puts its nodes back in the shared free list. Lists that share a pool
+ * must not be used from different threads at the same time, even though they
+ * are distinct lists. Copy the values into a fresh list to get an independent one.
+ */
+struct list_pool;
+
 struct list {
   struct list_node *first;
   struct list_node *last;
+  size_t size;
+  const struct allocator *allocator;
+  struct list_pool *pool;
 };
 
 /*
@@ -142,6 +482,11 @@ struct list {
  */
 void list_create(struct list *self);
 
+/*
+ * Create an empty list that gets its nodes from allocator
+ */
+void list_create_with(struct list *self, const struct allocator *allocator);
+
 /*
  * Create a list with initial content
  */
@@ -221,29 +566,347 @@ bool list_is_sorted(const struct list *self);
 
 /*
  * Split a list in two. At the end, self should be empty.
+ * The nodes are relinked, out1 and out2 then share the pool of self (see struct list_pool)
  */
 void list_split(struct list *self, struct list *out1, struct list *out2);
 
 /*
  * Merge two sorted lists in an empty list. At the end, in1 and in2 should be empty.
+ * The nodes are relinked and self joins the pool of in1 and in2 if they share one
+ * (e.g. after list_split), otherwise the values are copied
  */
 void list_merge(struct list *self, struct list *in1, struct list *in2);
 
 /*
- * Sort a list with merge sort
+ * Sort a list with merge sort, the nodes are relinked so nothing is allocated
  */
 void list_merge_sort(struct list *self);
 
+/*
+ * Sort a list with an iterative bottom-up merge sort (stable, no recursion, no allocation)
+ */
+void list_merge_sort_bottom_up(struct list *self);
+
+/*
+ * Copy the elements of the list in out, replacing its content
+ */
+void list_to_array(const struct list *self, struct array *out);
+
+/*
+ * Replace the content of the list with data, reusing the existing nodes
+ * Nodes are only allocated or freed when the sizes differ
+ */
+void list_assign_from_array(struct list *self, const int *data, size_t size);
+
+/*
+ * Sort a list by sorting its values in a temporary buffer of at most max_bytes,
+ * then writing them back in the same nodes. Falls back to list_merge_sort when
+ * the buffer does not fit in max_bytes or can not be allocated.
+ */
+void list_sort_contiguous(struct list *self, size_t max_bytes);
+
+/*
+ * A position in a list, node is NULL past the last element
+ */
+struct list_cursor {
+  struct list *list;
+  struct list_node *node;
+};
+
+/*
+ * Put the cursor on the first element of the list (past the end if empty)
+ */
+void list_cursor_first(struct list_cursor *self, struct list *list);
 
+/*
+ * Put the cursor on the last element of the list (past the end if empty)
+ */
+void list_cursor_last(struct list_cursor *self, struct list *list);
 
+/*
+ * Tell if the cursor is on an element
+ */
+bool list_cursor_valid(const struct list_cursor *self);
+
+/*
+ * Move the cursor to the next element, past the end after the last one
+ */
+void list_cursor_next(struct list_cursor *self);
+
+/*
+ * Move the cursor to the previous element, past the end before the first one
+ * From past the end, go to the last element
+ */
+void list_cursor_prev(struct list_cursor *self);
+
+/*
+ * Get the element under the cursor, 0 if the cursor is past the end
+ */
+int list_cursor_get(const struct list_cursor *self);
+
+/*
+ * Set the element under the cursor
+ */
+void list_cursor_set(struct list_cursor *self, int value);
+
+/*
+ * Insert an element before the cursor, at the end if the cursor is past the end
+ * The cursor stays on the same element
+ */
+void list_cursor_insert_before(struct list_cursor *self, int value);
+
+/*
+ * Insert an element after the cursor, the cursor must be on an element
+ * The cursor stays on the same element
+ */
+void list_cursor_insert_after(struct list_cursor *self, int value);
+
+/*
+ * Remove the element under the cursor and move the cursor to the next one
+ */
+void list_cursor_erase(struct list_cursor *self);
+
+
+/*
+ * An unrolled list keeps several values in each node, a node fits in a cache line
+ */
+#define UNROLLED_LIST_NODE_SIZE 64
+#define UNROLLED_LIST_NODE_CAPACITY ((UNROLLED_LIST_NODE_SIZE - 2 * sizeof(void *) - sizeof(unsigned)) / sizeof(int))
+
+struct unrolled_list_node {
+  struct unrolled_list_node *next;
+  struct unrolled_list_node *prev;
+  unsigned count;
+  int data[UNROLLED_LIST_NODE_CAPACITY];
+};
+
+struct unrolled_list {
+  struct unrolled_list_node *first;
+  struct unrolled_list_node *last;
+  size_t size;
+  const struct allocator *allocator;
+};
+
+/*
+ * Create an empty unrolled list
+ */
+void unrolled_list_create(struct unrolled_list *self);
+
+/*
+ * Create an empty unrolled list that gets its nodes from allocator
+ */
+void unrolled_list_create_with(struct unrolled_list *self, const struct allocator *allocator);
+
+/*
+ * Create an unrolled list with initial content
+ */
+void unrolled_list_create_from(struct unrolled_list *self, const int *other, size_t size);
+
+/*
+ * Destroy an unrolled list
+ */
+void unrolled_list_destroy(struct unrolled_list *self);
+
+/*
+ * Tell if the unrolled list is empty
+ */
+bool unrolled_list_empty(const struct unrolled_list *self);
+
+/*
+ * Get the size of the unrolled list
+ */
+size_t unrolled_list_size(const struct unrolled_list *self);
+
+/*
+ * Compare the unrolled list to an array
+ */
+bool unrolled_list_equals(const struct unrolled_list *self, const int *data, size_t size);
+
+/*
+ * Add an element in the unrolled list at the beginning
+ */
+void unrolled_list_push_front(struct unrolled_list *self, int value);
+
+/*
+ * Remove the element at the beginning of the unrolled list
+ */
+void unrolled_list_pop_front(struct unrolled_list *self);
+
+/*
+ * Add an element in the unrolled list at the end
+ */
+void unrolled_list_push_back(struct unrolled_list *self, int value);
+
+/*
+ * Remove the element at the end of the unrolled list
+ */
+void unrolled_list_pop_back(struct unrolled_list *self);
+
+/*
+ * Insert an element in the unrolled list (preserving the order)
+ * index is valid or equals to the size of the list (insert at the end)
+ * A full node is split in two
+ */
+void unrolled_list_insert(struct unrolled_list *self, int value, size_t index);
+
+/*
+ * Remove an element in the unrolled list (preserving the order)
+ * index is valid
+ * A node less than half full is merged with its neighbour when they fit in one node
+ */
+void unrolled_list_remove(struct unrolled_list *self, size_t index);
+
+/*
+ * Get the element at the specified index in the unrolled list
+ */
+int unrolled_list_get(const struct unrolled_list *self, size_t index);
+
+/*
+ * Set the element at the specified index in the unrolled list
+ */
+void unrolled_list_set(struct unrolled_list *self, size_t index, int value);
+
+/*
+ * Search for an element in the unrolled list and return its index or the size of the list if not present.
+ */
+size_t unrolled_list_search(const struct unrolled_list *self, int value);
+
+/*
+ * Tell if the unrolled list is sorted
+ */
+bool unrolled_list_is_sorted(const struct unrolled_list *self);
+
+/*
+ * Sort the unrolled list with a stable bottom-up merge sort on runs of nodes
+ * The values move, the nodes stay in place; uses a buffer of size values
+ */
+void unrolled_list_merge_sort(struct unrolled_list *self);
+
+
+/*
+ * An indexable skip list, each link knows how many elements it skips so that
+ * the operations by index are in expected O(log n)
+ */
+#define SKIP_LIST_MAX_LEVEL 16
+
+struct skip_list_node;
+
+struct skip_list_link {
+  struct skip_list_node *next;
+  size_t span;
+};
+
+struct skip_list {
+  struct skip_list_link head[SKIP_LIST_MAX_LEVEL];
+  unsigned level;
+  size_t size;
+  unsigned long long seed;
+  const struct allocator *allocator;
+};
+
+/*
+ * Create an empty skip list
+ */
+void skip_list_create(struct skip_list *self);
+
+/*
+ * Create an empty skip list that gets its nodes from allocator
+ */
+void skip_list_create_with(struct skip_list *self, const struct allocator *allocator);
+
+/*
+ * Create a skip list with initial content
+ */
+void skip_list_create_from(struct skip_list *self, const int *other, size_t size);
+
+/*
+ * Destroy a skip list
+ */
+void skip_list_destroy(struct skip_list *self);
+
+/*
+ * Tell if the skip list is empty
+ */
+bool skip_list_empty(const struct skip_list *self);
+
+/*
+ * Get the size of the skip list
+ */
+size_t skip_list_size(const struct skip_list *self);
+
+/*
+ * Compare the skip list to an array
+ */
+bool skip_list_equals(const struct skip_list *self, const int *data, size_t size);
+
+/*
+ * Add an element in the skip list at the beginning
+ */
+void skip_list_push_front(struct skip_list *self, int value);
+
+/*
+ * Remove the element at the beginning of the skip list
+ */
+void skip_list_pop_front(struct skip_list *self);
+
+/*
+ * Add an element in the skip list at the end
+ */
+void skip_list_push_back(struct skip_list *self, int value);
+
+/*
+ * Remove the element at the end of the skip list
+ */
+void skip_list_pop_back(struct skip_list *self);
+
+/*
+ * Insert an element in the skip list (preserving the order)
+ * index is valid or equals to the size of the list (insert at the end)
+ */
+void skip_list_insert(struct skip_list *self, int value, size_t index);
+
+/*
+ * Remove an element in the skip list (preserving the order)
+ * index is valid
+ */
+void skip_list_remove(struct skip_list *self, size_t index);
+
+/*
+ * Get the element at the specified index in the skip list
+ */
+int skip_list_get(const struct skip_list *self, size_t index);
+
+/*
+ * Set the element at the specified index in the skip list
+ */
+void skip_list_set(struct skip_list *self, size_t index, int value);
+
+/*
+ * Search for an element in a sorted skip list and return the index of its
+ * first occurrence or the size of the list if not present
+ */
+size_t skip_list_search(const struct skip_list *self, int value);
+
+/*
+ * Tell if the skip list is sorted
+ */
+bool skip_list_is_sorted(const struct skip_list *self);
+
+
+
+/*
+ * The tree is an AVL tree, the heights of the two subtrees of a node differ by at most one
+ */
 struct tree_node {
   int data;
+  int height; // Height of the subtree, 1 for a leaf
   struct tree_node *left;
   struct tree_node *right;
 };
 
 struct tree {
   struct tree_node *root;
+  const struct allocator *allocator;
 };
 
 /*
@@ -251,6 +914,11 @@ struct tree {
  */
 void tree_create(struct tree *self);
 
+/*
+ * Create an empty tree that gets its nodes from allocator
+ */
+void tree_create_with(struct tree *self, const struct allocator *allocator);
+
 /*
  * Create a tree
  */
@@ -306,6 +974,71 @@ void tree_walk_in_order(const struct tree *self, tree_func_t func, void *user_da
  */
 void tree_walk_post_order(const struct tree *self, tree_func_t func, void *user_data);
 
+/*
+ * A B+-tree set of int. The nodes are a few cache lines long, the values are
+ * all in the leaves and the leaves are linked in order for the scans.
+ */
+#define BPTREE_NODE_SIZE 256
+
+struct bptree_node;
+
+struct bptree {
+  struct bptree_node *root;
+  size_t size;
+  unsigned height; // Number of levels, 0 for an empty tree, 1 if the root is a leaf
+  const struct allocator *allocator;
+};
+
+/*
+ * Create an empty B+-tree
+ */
+void bptree_create(struct bptree *self);
+
+/*
+ * Create an empty B+-tree that gets its nodes from allocator
+ */
+void bptree_create_with(struct bptree *self, const struct allocator *allocator);
+
+/*
+ * Destroy a B+-tree
+ */
+void bptree_destroy(struct bptree *self);
+
+/*
+ * Tell if the B+-tree is empty
+ */
+bool bptree_empty(const struct bptree *self);
+
+/*
+ * Get the size of the B+-tree
+ */
+size_t bptree_size(const struct bptree *self);
+
+/*
+ * Tell if a value is in the B+-tree
+ */
+bool bptree_contains(const struct bptree *self, int value);
+
+/*
+ * Insert a value in the B+-tree and return false if the value was already present
+ */
+bool bptree_insert(struct bptree *self, int value);
+
+/*
+ * Remove a value from the B+-tree and return false if the value was not present
+ */
+bool bptree_remove(struct bptree *self, int value);
+
+/*
+ * Walk in the B+-tree in order and call the function with user_data as a second argument
+ */
+void bptree_walk_in_order(const struct bptree *self, tree_func_t func, void *user_data);
+
+/*
+ * Walk in order on the values between low and high (inclusive)
+ */
+void bptree_walk_range(const struct bptree *self, int low, int high, tree_func_t func, void *user_data);
+
 
 #ifdef __cplusplus
 }
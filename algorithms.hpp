@@ -0,0 +1,1182 @@
+#ifndef ALGORITHMS_HPP
+#define ALGORITHMS_HPP
+
+/*
+ * Header-only C++17 versions of the containers and algorithms of algorithms.h
+ *
+ * The element type and the comparator are template parameters, so the
+ * comparisons are inlined instead of going through a function pointer.
+ * Trivially copyable types are moved around with memcpy/memmove/realloc.
+ *
+ * algo::tree and algo::list give the same results as struct tree and struct list
+ * (same tree shapes and walk orders, same sort order). algo::array only gives the
+ * same results as struct array: it has no inline buffer, allocator or automatic
+ * shrink, and its quick sort picks the pivot with a median of three.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace algo {
+
+namespace detail {
+
+/*
+ * Allocate room for n elements (not constructed)
+ */
+template<typename T>
+T *allocate(std::size_t n) {
+  if (n == 0) {
+    return nullptr;
+  }
+  return static_cast<T *>(::operator new(n * sizeof(T)));
+}
+
+template<typename T>
+void deallocate(T *data) {
+  ::operator delete(data);
+}
+
+/*
+ * Move n constructed elements from src to the uninitialized dst, src is left uninitialized
+ * dst must be before src, or not overlap it
+ */
+template<typename T>
+void relocate_forward(T *dst, T *src, std::size_t n) {
+  if constexpr (std::is_trivially_copyable_v<T>) {
+    if (n > 0) {
+      std::memmove(dst, src, n * sizeof(T));
+    }
+  } else {
+    for (std::size_t i = 0; i < n; ++i) {
+      ::new (static_cast<void *>(dst + i)) T(std::move(src[i]));
+      src[i].~T();
+    }
+  }
+}
+
+/*
+ * Same as relocate_forward, but dst must be after src, or not overlap it
+ */
+template<typename T>
+void relocate_backward(T *dst, T *src, std::size_t n) {
+  if constexpr (std::is_trivially_copyable_v<T>) {
+    if (n > 0) {
+      std::memmove(dst, src, n * sizeof(T));
+    }
+  } else {
+    for (std::size_t i = n; i-- > 0;) {
+      ::new (static_cast<void *>(dst + i)) T(std::move(src[i]));
+      src[i].~T();
+    }
+  }
+}
+
+template<typename T>
+void destroy(T *data, std::size_t n) {
+  if constexpr (!std::is_trivially_destructible_v<T>) {
+    for (std::size_t i = 0; i < n; ++i) {
+      data[i].~T();
+    }
+  }
+}
+
+} // namespace detail
+
+/*
+ * Sorting and searching on a range of n elements
+ * comp(a, b) tells if a is strictly lower than b
+ */
+
+/*
+ * Search for an element and return its index, or n if not present
+ */
+template<typename T>
+std::size_t search(const T *data, std::size_t n, const T &value) {
+  for (std::size_t i = 0; i < n; ++i) {
+    if (data[i] == value) {
+      return i;
+    }
+  }
+  return n;
+}
+
+/*
+ * Search for an element in the sorted range and return its index, or n if not present
+ */
+template<typename T, typename Compare = std::less<T>>
+std::size_t search_sorted(const T *data, std::size_t n, const T &value, Compare comp = Compare()) {
+  std::size_t left = 0;
+  std::size_t right = n;
+
+  while (left < right) {
+    std::size_t mid = left + (right - left) / 2;
+    if (comp(data[mid], value)) {
+      left = mid + 1;
+    } else if (comp(value, data[mid])) {
+      right = mid;
+    } else {
+      return mid;
+    }
+  }
+  return n;
+}
+
+/*
+ * Tell if the range is sorted
+ */
+template<typename T, typename Compare = std::less<T>>
+bool is_sorted(const T *data, std::size_t n, Compare comp = Compare()) {
+  for (std::size_t i = 1; i < n; ++i) {
+    if (comp(data[i], data[i - 1])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Make a partition of the range between i and j (inclusive) around data[i] and returns the index of the pivot
+ */
+template<typename T, typename Compare = std::less<T>>
+std::ptrdiff_t partition(T *data, std::ptrdiff_t i, std::ptrdiff_t j, Compare comp = Compare()) {
+  std::ptrdiff_t left = i + 1;
+  std::ptrdiff_t right = j;
+
+  for (;;) {
+    while (left <= right && comp(data[left], data[i])) {
+      ++left;
+    }
+    while (left <= right && comp(data[i], data[right])) {
+      --right;
+    }
+    if (left >= right) {
+      break;
+    }
+    std::swap(data[left], data[right]);
+    ++left;
+    --right;
+  }
+  std::swap(data[i], data[right]);
+  return right;
+}
+
+/*
+ * Move the element at i down the heap of n elements where each node has Arity children
+ */
+template<std::size_t Arity = 2, typename T, typename Compare = std::less<T>>
+void heap_sift_down(T *data, std::size_t n, std::size_t i, Compare comp = Compare()) {
+  static_assert(Arity >= 2, "a heap node needs at least 2 children");
+  T value = std::move(data[i]);
+
+  for (;;) {
+    std::size_t first = Arity * i + 1;
+    if (first >= n) {
+      break;
+    }
+    std::size_t last = first + Arity < n ? first + Arity : n;
+    std::size_t largest = first;
+    for (std::size_t c = first + 1; c < last; ++c) {
+      if (comp(data[largest], data[c])) {
+        largest = c;
+      }
+    }
+    if (!comp(value, data[largest])) {
+      break;
+    }
+    data[i] = std::move(data[largest]);
+    i = largest;
+  }
+  data[i] = std::move(value);
+}
+
+/*
+ * Move the element at i up the heap where each node has Arity children
+ */
+template<std::size_t Arity = 2, typename T, typename Compare = std::less<T>>
+void heap_sift_up(T *data, std::size_t i, Compare comp = Compare()) {
+  static_assert(Arity >= 2, "a heap node needs at least 2 children");
+  T value = std::move(data[i]);
+
+  while (i > 0) {
+    std::size_t parent = (i - 1) / Arity;
+    if (!comp(data[parent], value)) {
+      break;
+    }
+    data[i] = std::move(data[parent]);
+    i = parent;
+  }
+  data[i] = std::move(value);
+}
+
+/*
+ * Tell if the range is a heap
+ */
+template<std::size_t Arity = 2, typename T, typename Compare = std::less<T>>
+bool is_heap(const T *data, std::size_t n, Compare comp = Compare()) {
+  for (std::size_t i = 1; i < n; ++i) {
+    if (comp(data[(i - 1) / Arity], data[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Reorganize the range into a heap in O(n)
+ */
+template<std::size_t Arity = 2, typename T, typename Compare = std::less<T>>
+void heap_build(T *data, std::size_t n, Compare comp = Compare()) {
+  if (n < 2) {
+    return;
+  }
+  for (std::size_t i = (n - 2) / Arity + 1; i-- > 0;) {
+    heap_sift_down<Arity>(data, n, i, comp);
+  }
+}
+
+/*
+ * Sort the range with a bottom-up heap sort
+ */
+template<typename T, typename Compare = std::less<T>>
+void heap_sort(T *data, std::size_t n, Compare comp = Compare()) {
+  if (n < 2) {
+    return;
+  }
+
+  // Put value in the heap of n elements where top is a hole
+  auto sink = [data, comp](std::size_t size, std::size_t top, T value) {
+    std::size_t i = top;
+    std::size_t child;
+    while ((child = 2 * i + 1) < size) {
+      if (child + 1 < size && comp(data[child], data[child + 1])) {
+        ++child;
+      }
+      data[i] = std::move(data[child]);
+      i = child;
+    }
+    while (i > top) {
+      std::size_t parent = (i - 1) / 2;
+      if (!comp(data[parent], value)) {
+        break;
+      }
+      data[i] = std::move(data[parent]);
+      i = parent;
+    }
+    data[i] = std::move(value);
+  };
+
+  for (std::size_t i = n / 2; i-- > 0;) {
+    sink(n, i, std::move(data[i]));
+  }
+
+  for (std::size_t i = n - 1; i > 0; --i) {
+    T value = std::move(data[i]);
+    data[i] = std::move(data[0]);
+    sink(i, 0, std::move(value));
+  }
+}
+
+namespace detail {
+
+constexpr std::ptrdiff_t insertion_sort_threshold = 16;
+
+template<typename T, typename Compare>
+void insertion_sort(T *data, std::ptrdiff_t low, std::ptrdiff_t high, Compare comp) {
+  for (std::ptrdiff_t i = low + 1; i <= high; ++i) {
+    T value = std::move(data[i]);
+    std::ptrdiff_t j = i;
+    while (j > low && comp(value, data[j - 1])) {
+      data[j] = std::move(data[j - 1]);
+      --j;
+    }
+    data[j] = std::move(value);
+  }
+}
+
+template<typename T, typename Compare>
+std::ptrdiff_t median_of_three(const T *data, std::ptrdiff_t a, std::ptrdiff_t b, std::ptrdiff_t c, Compare comp) {
+  if (comp(data[a], data[b])) {
+    if (comp(data[b], data[c])) {
+      return b;
+    }
+    return comp(data[a], data[c]) ? c : a;
+  }
+  if (comp(data[a], data[c])) {
+    return a;
+  }
+  return comp(data[b], data[c]) ? c : b;
+}
+
+template<typename T, typename Compare>
+void introsort(T *data, std::ptrdiff_t low, std::ptrdiff_t high, std::size_t depth_limit, Compare comp) {
+  while (high - low + 1 > insertion_sort_threshold) {
+    if (depth_limit == 0) {
+      heap_sort(data + low, static_cast<std::size_t>(high - low + 1), comp);
+      return;
+    }
+    --depth_limit;
+
+    std::ptrdiff_t mid = low + (high - low) / 2;
+    std::ptrdiff_t pivot = median_of_three(data, low, mid, high, comp);
+    std::swap(data[low], data[pivot]);
+
+    pivot = partition(data, low, high, comp);
+    if (pivot - low < high - pivot) {
+      introsort(data, low, pivot - 1, depth_limit, comp);
+      low = pivot + 1;
+    } else {
+      introsort(data, pivot + 1, high, depth_limit, comp);
+      high = pivot - 1;
+    }
+  }
+  insertion_sort(data, low, high, comp);
+}
+
+} // namespace detail
+
+/*
+ * Sort the range with an introsort (quick sort with a heap sort fallback)
+ */
+template<typename T, typename Compare = std::less<T>>
+void quick_sort(T *data, std::size_t n, Compare comp = Compare()) {
+  if (n <= 1) {
+    return;
+  }
+  std::size_t depth_limit = 0;
+  for (std::size_t m = n; m > 1; m /= 2) {
+    depth_limit += 2;
+  }
+  detail::introsort(data, 0, static_cast<std::ptrdiff_t>(n - 1), depth_limit, comp);
+}
+
+/*
+ * A dynamic array, the equivalent of struct array
+ */
+template<typename T, typename Compare = std::less<T>, std::size_t HeapArity = 2>
+class array {
+public:
+  array() = default;
+
+  array(const T *other, std::size_t size) {
+    append_range(other, size);
+  }
+
+  array(const array &other)
+  : m_growth_factor(other.m_growth_factor)
+  {
+    append_range(other.m_data, other.m_size);
+  }
+
+  array(array &&other) noexcept
+  : m_data(std::exchange(other.m_data, nullptr))
+  , m_capacity(std::exchange(other.m_capacity, 0))
+  , m_size(std::exchange(other.m_size, 0))
+  , m_growth_factor(other.m_growth_factor)
+  {
+  }
+
+  array &operator=(array other) noexcept {
+    std::swap(m_data, other.m_data);
+    std::swap(m_capacity, other.m_capacity);
+    std::swap(m_size, other.m_size);
+    std::swap(m_growth_factor, other.m_growth_factor);
+    return *this;
+  }
+
+  ~array() {
+    detail::destroy(m_data, m_size);
+    release(m_data);
+  }
+
+  bool empty() const {
+    return m_size == 0;
+  }
+
+  std::size_t size() const {
+    return m_size;
+  }
+
+  std::size_t capacity() const {
+    return m_capacity;
+  }
+
+  T *data() {
+    return m_data;
+  }
+
+  const T *data() const {
+    return m_data;
+  }
+
+  T &operator[](std::size_t index) {
+    return m_data[index];
+  }
+
+  const T &operator[](std::size_t index) const {
+    return m_data[index];
+  }
+
+  bool equals(const T *content, std::size_t size) const {
+    if (size != m_size) {
+      return false;
+    }
+    for (std::size_t i = 0; i < size; ++i) {
+      if (!(m_data[i] == content[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void set_growth_factor(double factor) {
+    if (std::isfinite(factor) && factor > 1.0) {
+      m_growth_factor = factor;
+    }
+  }
+
+  void reserve(std::size_t capacity) {
+    if (capacity > m_capacity) {
+      reallocate(capacity);
+    }
+  }
+
+  void shrink_to_fit() {
+    if (m_capacity != m_size) {
+      reallocate(m_size);
+    }
+  }
+
+  void push_back(const T &value) {
+    emplace_back(value);
+  }
+
+  void push_back(T &&value) {
+    emplace_back(std::move(value));
+  }
+
+  template<typename... Args>
+  void emplace_back(Args&&... args) {
+    if (m_size < m_capacity) {
+      ::new (static_cast<void *>(m_data + m_size)) T(std::forward<Args>(args)...);
+    } else {
+      // args could refer to an element, build the value before the buffer moves
+      T value(std::forward<Args>(args)...);
+      grow(m_size + 1);
+      ::new (static_cast<void *>(m_data + m_size)) T(std::move(value));
+    }
+    ++m_size;
+  }
+
+  void pop_back() {
+    if (m_size > 0) {
+      --m_size;
+      m_data[m_size].~T();
+    }
+  }
+
+  void insert(const T &value, std::size_t index) {
+    T copy(value); // value could be inside the array
+    insert_range(&copy, 1, index);
+  }
+
+  void remove(std::size_t index) {
+    remove_range(index, 1);
+  }
+
+  /*
+   * Insert size elements from other at index (preserving the order), other must not point inside the array
+   */
+  void insert_range(const T *other, std::size_t size, std::size_t index) {
+    if (index > m_size || size == 0) {
+      return;
+    }
+    grow(m_size + size);
+    detail::relocate_backward(m_data + index + size, m_data + index, m_size - index);
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      std::memcpy(m_data + index, other, size * sizeof(T));
+    } else {
+      for (std::size_t i = 0; i < size; ++i) {
+        ::new (static_cast<void *>(m_data + index + i)) T(other[i]);
+      }
+    }
+    m_size += size;
+  }
+
+  void append_range(const T *other, std::size_t size) {
+    insert_range(other, size, m_size);
+  }
+
+  /*
+   * Remove count elements starting at index (preserving the order)
+   */
+  void remove_range(std::size_t index, std::size_t count) {
+    if (index >= m_size || count > m_size - index || count == 0) {
+      return;
+    }
+    detail::destroy(m_data + index, count);
+    detail::relocate_forward(m_data + index, m_data + index + count, m_size - index - count);
+    m_size -= count;
+  }
+
+  std::size_t search(const T &value) const {
+    return algo::search(m_data, m_size, value);
+  }
+
+  std::size_t search_sorted(const T &value) const {
+    return algo::search_sorted(m_data, m_size, value, Compare());
+  }
+
+  bool is_sorted() const {
+    return algo::is_sorted(m_data, m_size, Compare());
+  }
+
+  void quick_sort() {
+    algo::quick_sort(m_data, m_size, Compare());
+  }
+
+  void heap_sort() {
+    algo::heap_sort(m_data, m_size, Compare());
+  }
+
+  bool is_heap() const {
+    return algo::is_heap<HeapArity>(m_data, m_size, Compare());
+  }
+
+  void heap_build() {
+    algo::heap_build<HeapArity>(m_data, m_size, Compare());
+  }
+
+  void heap_add(const T &value) {
+    push_back(value);
+    algo::heap_sift_up<HeapArity>(m_data, m_size - 1, Compare());
+  }
+
+  const T &heap_top() const {
+    return m_data[0];
+  }
+
+  void heap_remove_top() {
+    if (m_size == 0) {
+      return;
+    }
+    if (m_size > 1) {
+      m_data[0] = std::move(m_data[m_size - 1]);
+    }
+    pop_back();
+    if (m_size > 1) {
+      algo::heap_sift_down<HeapArity>(m_data, m_size, 0, Compare());
+    }
+  }
+
+private:
+  static void release(T *data) {
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      std::free(data);
+    } else {
+      detail::deallocate(data);
+    }
+  }
+
+  void reallocate(std::size_t capacity) {
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      if (capacity == 0) {
+        std::free(m_data);
+        m_data = nullptr;
+      } else {
+        void *data = std::realloc(m_data, capacity * sizeof(T));
+        if (data == nullptr) {
+          throw std::bad_alloc();
+        }
+        m_data = static_cast<T *>(data);
+      }
+    } else {
+      T *data = detail::allocate<T>(capacity);
+      detail::relocate_forward(data, m_data, m_size);
+      detail::deallocate(m_data);
+      m_data = data;
+    }
+    m_capacity = capacity;
+  }
+
+  void grow(std::size_t needed) {
+    if (needed <= m_capacity) {
+      return;
+    }
+    // No object can be bigger than PTRDIFF_MAX bytes
+    const std::size_t max_capacity = static_cast<std::size_t>(PTRDIFF_MAX) / sizeof(T);
+    if (needed > max_capacity) {
+      throw std::bad_alloc();
+    }
+    // Clamped before the conversion, a double too big for size_t is undefined behavior
+    double grown = static_cast<double>(m_capacity) * m_growth_factor;
+    std::size_t capacity = grown >= static_cast<double>(max_capacity) ? max_capacity : static_cast<std::size_t>(grown);
+    if (capacity < needed) {
+      capacity = needed;
+    }
+    reallocate(capacity);
+  }
+
+  T *m_data = nullptr;
+  std::size_t m_capacity = 0;
+  std::size_t m_size = 0;
+  double m_growth_factor = 2.0;
+};
+
+/*
+ * A doubly linked list, the equivalent of struct list
+ */
+template<typename T, typename Compare = std::less<T>>
+class list {
+public:
+  struct node {
+    T data;
+    node *next;
+    node *prev;
+  };
+
+  list() = default;
+
+  list(const T *other, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i) {
+      push_back(other[i]);
+    }
+  }
+
+  list(const list &other) {
+    for (node *curr = other.m_first; curr != nullptr; curr = curr->next) {
+      push_back(curr->data);
+    }
+  }
+
+  list(list &&other) noexcept
+  : m_first(std::exchange(other.m_first, nullptr))
+  , m_last(std::exchange(other.m_last, nullptr))
+  , m_size(std::exchange(other.m_size, 0))
+  {
+  }
+
+  list &operator=(list other) noexcept {
+    std::swap(m_first, other.m_first);
+    std::swap(m_last, other.m_last);
+    std::swap(m_size, other.m_size);
+    return *this;
+  }
+
+  ~list() {
+    node *curr = m_first;
+    while (curr != nullptr) {
+      node *next = curr->next;
+      delete curr;
+      curr = next;
+    }
+  }
+
+  bool empty() const {
+    return m_first == nullptr;
+  }
+
+  std::size_t size() const {
+    return m_size;
+  }
+
+  node *first() const {
+    return m_first;
+  }
+
+  node *last() const {
+    return m_last;
+  }
+
+  bool equals(const T *data, std::size_t size) const {
+    if (size != m_size) {
+      return false;
+    }
+    node *curr = m_first;
+    for (std::size_t i = 0; i < size; ++i, curr = curr->next) {
+      if (!(curr->data == data[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void push_front(const T &value) {
+    link_before(new node{ value, nullptr, nullptr }, m_first);
+  }
+
+  void push_back(const T &value) {
+    link_before(new node{ value, nullptr, nullptr }, nullptr);
+  }
+
+  void pop_front() {
+    if (m_first != nullptr) {
+      delete unlink(m_first);
+    }
+  }
+
+  void pop_back() {
+    if (m_last != nullptr) {
+      delete unlink(m_last);
+    }
+  }
+
+  /*
+   * index is valid or equals to the size of the list (insert at the end)
+   */
+  void insert(const T &value, std::size_t index) {
+    if (index > m_size) {
+      return;
+    }
+    link_before(new node{ value, nullptr, nullptr }, at(index));
+  }
+
+  void remove(std::size_t index) {
+    if (index < m_size) {
+      delete unlink(at(index));
+    }
+  }
+
+  /*
+   * Get a pointer to the element at index, or nullptr if the index is not valid
+   */
+  T *get(std::size_t index) {
+    node *curr = at(index);
+    return curr != nullptr ? &curr->data : nullptr;
+  }
+
+  std::size_t search(const T &value) const {
+    std::size_t i = 0;
+    for (node *curr = m_first; curr != nullptr; curr = curr->next, ++i) {
+      if (curr->data == value) {
+        return i;
+      }
+    }
+    return i;
+  }
+
+  bool is_sorted() const {
+    Compare comp;
+    for (node *curr = m_first; curr != nullptr && curr->next != nullptr; curr = curr->next) {
+      if (comp(curr->next->data, curr->data)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /*
+   * Sort the list with a bottom-up merge sort that relinks the nodes (stable, no allocation)
+   */
+  void merge_sort() {
+    if (m_size < 2) {
+      return;
+    }
+    Compare comp;
+    node *head = m_first;
+
+    for (std::size_t width = 1; width < m_size; width *= 2) {
+      node *rest = head;
+      node *tail = nullptr;
+      head = nullptr;
+
+      while (rest != nullptr) {
+        node *left = rest;
+        node *right = cut(left, width);
+        rest = cut(right, width);
+
+        // Merge left and right at the end of the new chain
+        while (left != nullptr || right != nullptr) {
+          node *next;
+          if (right == nullptr || (left != nullptr && !comp(right->data, left->data))) {
+            next = left;
+            left = left->next;
+          } else {
+            next = right;
+            right = right->next;
+          }
+          if (tail == nullptr) {
+            head = next;
+          } else {
+            tail->next = next;
+          }
+          tail = next;
+        }
+      }
+      tail->next = nullptr;
+    }
+
+    // Restore the prev links
+    node *prev = nullptr;
+    for (node *curr = head; curr != nullptr; curr = curr->next) {
+      curr->prev = prev;
+      prev = curr;
+    }
+    m_first = head;
+    m_last = prev;
+  }
+
+private:
+  node *at(std::size_t index) const {
+    node *curr = m_first;
+    for (std::size_t i = 0; i < index && curr != nullptr; ++i) {
+      curr = curr->next;
+    }
+    return curr;
+  }
+
+  /*
+   * Link a new node before next (or at the end if next is nullptr)
+   */
+  void link_before(node *n, node *next) {
+    n->next = next;
+    n->prev = next != nullptr ? next->prev : m_last;
+    if (n->prev != nullptr) {
+      n->prev->next = n;
+    } else {
+      m_first = n;
+    }
+    if (next != nullptr) {
+      next->prev = n;
+    } else {
+      m_last = n;
+    }
+    ++m_size;
+  }
+
+  node *unlink(node *n) {
+    if (n->prev != nullptr) {
+      n->prev->next = n->next;
+    } else {
+      m_first = n->next;
+    }
+    if (n->next != nullptr) {
+      n->next->prev = n->prev;
+    } else {
+      m_last = n->prev;
+    }
+    --m_size;
+    return n;
+  }
+
+  /*
+   * Cut the chain after count nodes and return the rest
+   */
+  static node *cut(node *chain, std::size_t count) {
+    for (std::size_t i = 1; chain != nullptr && i < count; ++i) {
+      chain = chain->next;
+    }
+    if (chain == nullptr) {
+      return nullptr;
+    }
+    node *rest = chain->next;
+    chain->next = nullptr;
+    return rest;
+  }
+
+  node *m_first = nullptr;
+  node *m_last = nullptr;
+  std::size_t m_size = 0;
+};
+
+/*
+ * An AVL tree, the equivalent of struct tree
+ * None of the operations recurse, the height of the tree bounds the stacks
+ */
+template<typename T, typename Compare = std::less<T>>
+class tree {
+public:
+  struct node {
+    T data;
+    int height; // Height of the subtree, 1 for a leaf
+    node *left;
+    node *right;
+  };
+
+  tree() = default;
+
+  tree(const tree &) = delete;
+  tree &operator=(const tree &) = delete;
+
+  tree(tree &&other) noexcept
+  : m_root(std::exchange(other.m_root, nullptr))
+  {
+  }
+
+  ~tree() {
+    destroy(m_root);
+  }
+
+  bool empty() const {
+    return m_root == nullptr;
+  }
+
+  std::size_t size() const {
+    const node *stack[max_height];
+    std::size_t top = 0;
+    std::size_t count = 0;
+    const node *curr = m_root;
+    while (curr != nullptr || top > 0) {
+      if (curr == nullptr) {
+        curr = stack[--top];
+      }
+      ++count;
+      if (curr->right != nullptr) {
+        stack[top++] = curr->right;
+      }
+      curr = curr->left;
+    }
+    return count;
+  }
+
+  std::size_t height() const {
+    return static_cast<std::size_t>(height(m_root));
+  }
+
+  bool contains(const T &value) const {
+    Compare comp;
+    node *curr = m_root;
+    while (curr != nullptr) {
+      if (comp(value, curr->data)) {
+        curr = curr->left;
+      } else if (comp(curr->data, value)) {
+        curr = curr->right;
+      } else {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /*
+   * Insert a value and return false if the value was already present
+   */
+  bool insert(const T &value) {
+    Compare comp;
+    node **path[max_height];
+    std::size_t depth = 0;
+    node **link = &m_root;
+    while (*link != nullptr) {
+      if (comp(value, (*link)->data)) {
+        path[depth++] = link;
+        link = &(*link)->left;
+      } else if (comp((*link)->data, value)) {
+        path[depth++] = link;
+        link = &(*link)->right;
+      } else {
+        return false;
+      }
+    }
+    *link = new node{ value, 1, nullptr, nullptr };
+    rebalance_path(path, depth);
+    return true;
+  }
+
+  /*
+   * Remove a value and return false if the value was not present
+   */
+  bool remove(const T &value) {
+    Compare comp;
+    node **path[max_height];
+    std::size_t depth = 0;
+    node **link = &m_root;
+    while (*link != nullptr) {
+      if (comp(value, (*link)->data)) {
+        path[depth++] = link;
+        link = &(*link)->left;
+      } else if (comp((*link)->data, value)) {
+        path[depth++] = link;
+        link = &(*link)->right;
+      } else {
+        break;
+      }
+    }
+    node *curr = *link;
+    if (curr == nullptr) {
+      return false;
+    }
+    if (curr->left == nullptr) {
+      *link = curr->right;
+    } else if (curr->right == nullptr) {
+      *link = curr->left;
+    } else {
+      // Unlink the in-order successor and put it in place of the node
+      path[depth++] = link;
+      std::size_t first = depth;
+      node **min = &curr->right;
+      while ((*min)->left != nullptr) {
+        path[depth++] = min;
+        min = &(*min)->left;
+      }
+      node *successor = *min;
+      *min = successor->right;
+      successor->left = curr->left;
+      successor->right = curr->right;
+      *link = successor;
+      // The link to the right child moved from the node to its successor
+      if (depth > first) {
+        path[first] = &successor->right;
+      }
+    }
+    delete curr;
+    rebalance_path(path, depth);
+    return true;
+  }
+
+  /*
+   * Walk in the tree and call func on every value, func is inlined
+   * As for struct tree, the pre order walk visits the right subtree first
+   */
+  template<typename Func>
+  void walk_pre_order(Func &&func) const {
+    const node *stack[max_height + 1];
+    std::size_t top = 0;
+    if (m_root != nullptr) {
+      stack[top++] = m_root;
+    }
+    while (top > 0) {
+      const node *curr = stack[--top];
+      func(curr->data);
+      if (curr->left != nullptr) {
+        stack[top++] = curr->left;
+      }
+      if (curr->right != nullptr) {
+        stack[top++] = curr->right;
+      }
+    }
+  }
+
+  template<typename Func>
+  void walk_in_order(Func &&func) const {
+    const node *stack[max_height];
+    std::size_t top = 0;
+    const node *curr = m_root;
+    while (curr != nullptr || top > 0) {
+      while (curr != nullptr) {
+        stack[top++] = curr;
+        curr = curr->left;
+      }
+      curr = stack[--top];
+      func(curr->data);
+      curr = curr->right;
+    }
+  }
+
+  template<typename Func>
+  void walk_post_order(Func &&func) const {
+    const node *stack[max_height];
+    std::size_t top = 0;
+    const node *curr = m_root;
+    const node *last = nullptr;
+    while (curr != nullptr || top > 0) {
+      while (curr != nullptr) {
+        stack[top++] = curr;
+        curr = curr->left;
+      }
+      const node *parent = stack[top - 1];
+      if (parent->right != nullptr && parent->right != last) {
+        curr = parent->right;
+      } else {
+        func(parent->data);
+        last = parent;
+        --top;
+      }
+    }
+  }
+
+private:
+  /*
+   * An AVL tree of n nodes is less than 1.45 * log2(n + 2) high
+   */
+  static constexpr std::size_t max_height = 96;
+
+  static int height(const node *n) {
+    return n != nullptr ? n->height : 0;
+  }
+
+  static void update(node *n) {
+    int left = height(n->left);
+    int right = height(n->right);
+    n->height = (left > right ? left : right) + 1;
+  }
+
+  static node *rotate_right(node *n) {
+    node *left = n->left;
+    n->left = left->right;
+    left->right = n;
+    update(n);
+    update(left);
+    return left;
+  }
+
+  static node *rotate_left(node *n) {
+    node *right = n->right;
+    n->right = right->left;
+    right->left = n;
+    update(n);
+    update(right);
+    return right;
+  }
+
+  /*
+   * Rebalance the nodes of a path from the deepest one up to the root
+   */
+  static void rebalance_path(node ***path, std::size_t depth) {
+    while (depth > 0) {
+      node **link = path[--depth];
+      node *curr = *link;
+      int balance = height(curr->left) - height(curr->right);
+      if (balance > 1) {
+        if (height(curr->left->left) < height(curr->left->right)) {
+          curr->left = rotate_left(curr->left);
+        }
+        *link = rotate_right(curr);
+      } else if (balance < -1) {
+        if (height(curr->right->right) < height(curr->right->left)) {
+          curr->right = rotate_right(curr->right);
+        }
+        *link = rotate_left(curr);
+      } else {
+        update(curr);
+      }
+    }
+  }
+
+  /*
+   * Rotate the left children up until the node has none, then delete it
+   */
+  static void destroy(node *n) {
+    while (n != nullptr) {
+      if (n->left != nullptr) {
+        node *left = n->left;
+        n->left = left->right;
+        left->right = n;
+        n = left;
+      } else {
+        node *right = n->right;
+        delete n;
+        n = right;
+      }
+    }
+  }
+
+  node *m_root = nullptr;
+};
+
+/*
+ * The containers of algorithms.h
+ */
+using int_array = array<int>;
+using int_list = list<int>;
+using int_tree = tree<int>;
+
+} // namespace algo
+
+#endif // ALGORITHMS_HPP
@@ -1,15 +1,189 @@
 #include "gtest/gtest.h"
 
 #include <cassert>
+#include <climits>
+#include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
+#include <algorithm>
 #include <array>
+#include <string>
+#include <vector>
 
 #include "algorithms.h"
+#include "algorithms.hpp"
 
 #define BIG_SIZE 1000
 
+/*
+ * allocators
+ */
+
+struct counting_allocator_stats {
+  std::size_t allocated = 0;
+  std::size_t calls = 0;
+};
+
+static void *counting_allocate(void *ctx, std::size_t size) {
+  auto stats = static_cast<counting_allocator_stats *>(ctx);
+  stats->allocated += size;
+  stats->calls++;
+  return std::malloc(size);
+}
+
+static void *counting_reallocate(void *ctx, void *ptr, std::size_t old_size, std::size_t new_size) {
+  auto stats = static_cast<counting_allocator_stats *>(ctx);
+  stats->allocated += new_size;
+  stats->allocated -= old_size;
+  stats->calls++;
+  return std::realloc(ptr, new_size);
+}
+
+static void counting_deallocate(void *ctx, void *ptr, std::size_t size) {
+  auto stats = static_cast<counting_allocator_stats *>(ctx);
+  stats->allocated -= size;
+  std::free(ptr);
+}
+
+TEST(AllocatorTest, Counting) {
+  counting_allocator_stats stats;
+  struct allocator allocator = { counting_allocate, counting_reallocate, counting_deallocate, &stats };
+
+  struct array a;
+  struct list l;
+  struct tree t;
+  array_create_with(&a, &allocator);
+  list_create_with(&l, &allocator);
+  tree_create_with(&t, &allocator);
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    array_push_back(&a, i);
+    list_push_back(&l, i);
+    tree_insert(&t, (i * 7) % BIG_SIZE);
+  }
+
+  EXPECT_GT(stats.allocated, BIG_SIZE * (sizeof(int) + sizeof(struct list_node) + sizeof(struct tree_node)));
+
+  for (int i = 0; i < BIG_SIZE / 2; ++i) {
+    array_pop_back(&a);
+    list_pop_front(&l);
+    tree_remove(&t, i);
+  }
+
+  array_destroy(&a);
+  list_destroy(&l);
+  tree_destroy(&t);
+
+  EXPECT_EQ(stats.allocated, 0u);
+}
+
+TEST(AllocatorTest, Default) {
+  counting_allocator_stats stats;
+  struct allocator allocator = { counting_allocate, counting_reallocate, counting_deallocate, &stats };
+
+  allocator_set_default(&allocator);
+  EXPECT_EQ(allocator_get_default(), &allocator);
+
+  struct list l;
+  list_create(&l);
+  list_push_back(&l, 1);
+
+  allocator_set_default(nullptr);
+  EXPECT_EQ(allocator_get_default(), &allocator_system);
+
+  EXPECT_GT(stats.calls, 0u);
+
+  list_destroy(&l);
+
+  EXPECT_EQ(stats.allocated, 0u);
+}
+
+TEST(AllocatorTest, Arena) {
+  struct arena arena;
+  arena_create(&arena, 4096);
+
+  struct allocator allocator;
+  arena_allocator(&arena, &allocator);
+
+  for (int round = 0; round < 3; ++round) {
+    struct array a;
+    struct list l;
+    struct tree t;
+    array_create_with(&a, &allocator);
+    list_create_with(&l, &allocator);
+    tree_create_with(&t, &allocator);
+
+    for (int i = 0; i < BIG_SIZE; ++i) {
+      array_push_back(&a, i);
+      list_push_back(&l, i);
+      tree_insert(&t, (i * 7) % BIG_SIZE);
+    }
+
+    for (int i = 0; i < BIG_SIZE; ++i) {
+      EXPECT_EQ(array_get(&a, i), i);
+      EXPECT_TRUE(tree_contains(&t, i));
+    }
+
+    EXPECT_EQ(list_size(&l), static_cast<std::size_t>(BIG_SIZE));
+
+    // Everything is given back at once, no need to destroy the containers
+    arena_reset(&arena);
+  }
+
+  arena_destroy(&arena);
+}
+
+TEST(AllocatorTest, ArenaReallocInPlace) {
+  struct arena arena;
+  arena_create(&arena, 4096);
+
+  struct allocator allocator;
+  arena_allocator(&arena, &allocator);
+
+  void *ptr = allocator.allocate(allocator.ctx, 100);
+  EXPECT_EQ(allocator.reallocate(allocator.ctx, ptr, 100, 200), ptr);
+
+  void *other = allocator.allocate(allocator.ctx, 16);
+  EXPECT_NE(allocator.reallocate(allocator.ctx, ptr, 200, 300), ptr);
+
+  allocator.deallocate(allocator.ctx, other, 16);
+  arena_destroy(&arena);
+}
+
+TEST(AllocatorTest, ThreadCache) {
+  struct list l;
+  list_create_with(&l, &allocator_thread_cache);
+
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < BIG_SIZE; ++i) {
+      list_push_front(&l, i);
+    }
+
+    EXPECT_EQ(list_size(&l), static_cast<std::size_t>(BIG_SIZE));
+    EXPECT_EQ(list_get(&l, 0), BIG_SIZE - 1);
+
+    for (int i = 0; i < BIG_SIZE; ++i) {
+      list_pop_front(&l);
+    }
+  }
+
+  struct array a;
+  array_create_with(&a, &allocator_thread_cache);
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    array_push_back(&a, i);
+  }
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    EXPECT_EQ(array_get(&a, i), i);
+  }
+
+  array_destroy(&a);
+  list_destroy(&l);
+}
+
 /*
  * array_create
  */
@@ -94,6 +268,39 @@ TEST(ArrayEqualsTest, SizeLarger) {
   array_destroy(&a);
 }
 
+static const enum array_simd simd_levels[] = { ARRAY_SIMD_SCALAR, ARRAY_SIMD_SSE2, ARRAY_SIMD_AVX2 };
+
+TEST(ArrayEqualsTest, EveryPosition) {
+  int origin[100];
+
+  for (int i = 0; i < 100; ++i) {
+    origin[i] = i;
+  }
+
+  // Every kernel, whatever the CPU picks by default
+  for (enum array_simd level : simd_levels) {
+    SCOPED_TRACE(level);
+    array_set_simd(level);
+
+    struct array a;
+    array_create_from(&a, origin, std::size(origin));
+
+    for (std::size_t size = 0; size <= std::size(origin); ++size) {
+      a.size = size;
+      EXPECT_TRUE(array_equals(&a, origin, size));
+
+      for (std::size_t i = 0; i < size; ++i) {
+        origin[i] = -1;
+        EXPECT_FALSE(array_equals(&a, origin, size));
+        origin[i] = static_cast<int>(i);
+      }
+    }
+
+    array_destroy(&a);
+  }
+  array_set_simd(ARRAY_SIMD_AUTO);
+}
+
 /*
  * array_push_back
  */
@@ -307,266 +514,946 @@ TEST(ArrayRemoveTest, End) {
 }
 
 /*
- * array_get
+ * array_assign
  */
 
-TEST(ArrayGetTest, ValidIndex) {
+TEST(ArrayAssignTest, ManyElements) {
   static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+  static const int other[] = { 1, 2, 3 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  for (std::size_t i = 0; i < std::size(origin); ++i) {
-    EXPECT_EQ(array_get(&a, i), origin[i]);
-  }
+  array_assign(&a, other, std::size(other));
+
+  EXPECT_TRUE(array_equals(&a, other, std::size(other)));
 
   array_destroy(&a);
 }
 
-TEST(ArrayGetTest, NotValidIndex) {
+TEST(ArrayAssignTest, Empty) {
   static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  EXPECT_EQ(array_get(&a, std::size(origin)), 0);
-  EXPECT_EQ(array_get(&a, -1), 0);
+  array_assign(&a, nullptr, 0);
+
+  EXPECT_TRUE(array_empty(&a));
 
   array_destroy(&a);
 }
 
 /*
- * array_set
+ * array_append_range
  */
 
-TEST(ArraySetTest, ValidIndex) {
-  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+TEST(ArrayAppendRangeTest, ManyElements) {
+  static const int origin[] = { 9, 3, 7 };
+  static const int other[] = { 2, 4, 0, 8 };
+  static const int expected[] = { 9, 3, 7, 2, 4, 0, 8 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  for (std::size_t i = 0; i < std::size(origin); ++i) {
-    array_set(&a, i, origin[i] - 1);
-    EXPECT_EQ(array_get(&a, i), origin[i] - 1);
-  }
+  array_append_range(&a, other, std::size(other));
 
-  EXPECT_EQ(array_size(&a), std::size(origin));
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
 
   array_destroy(&a);
 }
 
-TEST(ArraySetTest, NotValidIndex) {
-  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+TEST(ArrayAppendRangeTest, Stressed) {
+  int values[BIG_SIZE];
 
-  struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    values[i] = i;
+  }
 
-  array_set(&a, std::size(origin), 42);
-  array_set(&a, -1, 42);
+  struct array a;
+  array_create(&a);
 
-  EXPECT_EQ(array_size(&a), std::size(origin));
+  for (int i = 0; i < 10; ++i) {
+    array_append_range(&a, values, BIG_SIZE);
+    EXPECT_EQ(array_size(&a), static_cast<std::size_t>((i + 1) * BIG_SIZE));
+  }
 
-  for (std::size_t i = 0; i < std::size(origin); ++i) {
-    EXPECT_EQ(array_get(&a, i), origin[i]);
+  for (std::size_t i = 0; i < array_size(&a); ++i) {
+    EXPECT_EQ(array_get(&a, i), static_cast<int>(i % BIG_SIZE));
   }
 
   array_destroy(&a);
 }
 
 /*
- * array_search
+ * array_insert_range
  */
 
-TEST(ArraySearchTest, Present) {
-  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+TEST(ArrayInsertRangeTest, Beginning) {
+  static const int origin[] = { 9, 3, 7, 2 };
+  static const int other[] = { 42, 43, 44 };
+  static const int expected[] = { 42, 43, 44, 9, 3, 7, 2 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  for (size_t i = 0; i < std::size(origin); ++i) {
-    size_t index = array_search(&a, origin[i]);
-    EXPECT_EQ(index, i);
-  }
+  array_insert_range(&a, other, std::size(other), 0);
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
 
   array_destroy(&a);
 }
 
-TEST(ArraySearchTest, NotPresent) {
-  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+TEST(ArrayInsertRangeTest, Middle) {
+  static const int origin[] = { 9, 3, 7, 2 };
+  static const int other[] = { 42, 43, 44 };
+  static const int expected[] = { 9, 3, 42, 43, 44, 7, 2 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  size_t index = array_search(&a, -1);
-  EXPECT_EQ(index, std::size(origin));
+  array_insert_range(&a, other, std::size(other), 2);
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
 
   array_destroy(&a);
 }
 
-/*
- * array_search_sorted
- */
-
-TEST(ArraySearchSortedTest, Present) {
-  static const int origin[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
+TEST(ArrayInsertRangeTest, End) {
+  static const int origin[] = { 9, 3, 7, 2 };
+  static const int other[] = { 42, 43, 44 };
+  static const int expected[] = { 9, 3, 7, 2, 42, 43, 44 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  for (size_t i = 0; i < std::size(origin); ++i) {
-    size_t index = array_search_sorted(&a, origin[i]);
-    EXPECT_EQ(index, i);
-  }
+  array_insert_range(&a, other, std::size(other), std::size(origin));
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
 
   array_destroy(&a);
 }
 
-
-TEST(ArraySearchSortedTest, NotPresentBefore) {
-  static const int origin[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
+TEST(ArrayInsertRangeTest, NotValidIndex) {
+  static const int origin[] = { 9, 3, 7, 2 };
+  static const int other[] = { 42, 43, 44 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  size_t index = array_search_sorted(&a, -1); // before everything
-  EXPECT_EQ(index, std::size(origin));
+  array_insert_range(&a, other, std::size(other), std::size(origin) + 1);
+
+  EXPECT_TRUE(array_equals(&a, origin, std::size(origin)));
 
   array_destroy(&a);
 }
 
-TEST(ArraySearchSortedTest, NotPresentAfter) {
-  static const int origin[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
+/*
+ * array_remove_range
+ */
+
+TEST(ArrayRemoveRangeTest, Beginning) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+  static const int expected[] = { 2, 4, 0, 8 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  size_t index = array_search_sorted(&a, 15); // after everything
-  EXPECT_EQ(index, std::size(origin));
+  array_remove_range(&a, 0, 3);
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
 
   array_destroy(&a);
 }
 
-TEST(ArraySearchSortedTest, NotPresentMiddle) {
-  static const int origin[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
+TEST(ArrayRemoveRangeTest, Middle) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+  static const int expected[] = { 9, 3, 0, 8 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  size_t index = array_search_sorted(&a, 4); // in the middle of other elements
-  EXPECT_EQ(index, std::size(origin));
+  array_remove_range(&a, 2, 3);
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
 
   array_destroy(&a);
 }
 
-/*
- * array_is_sorted
- */
+TEST(ArrayRemoveRangeTest, End) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+  static const int expected[] = { 9, 3, 7, 2 };
 
-TEST(ArrayIsSortedTest, Empty) {
   struct array a;
-  array_create(&a);
+  array_create_from(&a, origin, std::size(origin));
 
-  EXPECT_TRUE(array_is_sorted(&a));
+  array_remove_range(&a, 4, 3);
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
 
   array_destroy(&a);
 }
 
-TEST(ArrayIsSortedTest, Sorted) {
-  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+TEST(ArrayRemoveRangeTest, NotValidRange) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  EXPECT_TRUE(array_is_sorted(&a));
+  array_remove_range(&a, 4, 4);
+
+  EXPECT_TRUE(array_equals(&a, origin, std::size(origin)));
 
   array_destroy(&a);
 }
 
-TEST(ArrayIsSortedTest, NotSorted) {
-  static const int origin[] = { 0, 1, 2, 3, 4, 5, 10, 9, 8, 7, 6 };
+/*
+ * array_reserve
+ */
+
+TEST(ArrayReserveTest, Grow) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  EXPECT_FALSE(array_is_sorted(&a));
+  array_reserve(&a, 1000);
+
+  EXPECT_GE(a.capacity, 1000u);
+  EXPECT_TRUE(array_equals(&a, origin, std::size(origin)));
+
+  int *data = a.data;
+
+  for (int i = 0; i < 900; ++i) {
+    array_push_back(&a, i);
+  }
+
+  EXPECT_EQ(a.data, data); // no reallocation needed
 
   array_destroy(&a);
 }
 
-TEST(ArrayIsSortedTest, NotSortedAtTheEnd) {
-  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0 };
-
+TEST(ArrayReserveTest, Smaller) {
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  array_create(&a);
 
-  EXPECT_FALSE(array_is_sorted(&a));
+  std::size_t capacity = a.capacity;
+  array_reserve(&a, 1);
+
+  EXPECT_EQ(a.capacity, capacity);
 
   array_destroy(&a);
 }
 
 /*
- * array_partition
+ * array_shrink_to_fit
  */
 
-TEST(ArrayPartitionTest, WholeSorted) {
-  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
-
+TEST(ArrayShrinkToFitTest, ManyElements) {
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
-
-  ptrdiff_t p = array_partition(&a, 0, std::size(origin) - 1);
-  int pivot = array_get(&a, p);
+  array_create(&a);
 
-  for (ptrdiff_t i = 0; i < p; ++i) {
-    EXPECT_LT(array_get(&a, i), pivot);
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    array_push_back(&a, i);
   }
 
-  for (ptrdiff_t i = p + 1; i < static_cast<ptrdiff_t>(std::size(origin)); ++i) {
-    EXPECT_GT(array_get(&a, i), pivot);
+  for (int i = 0; i < BIG_SIZE / 2; ++i) {
+    array_pop_back(&a);
   }
 
-  for (int val : origin) {
-    EXPECT_NE(array_search(&a, val), std::size(origin));
+  array_shrink_to_fit(&a);
+
+  EXPECT_EQ(a.capacity, static_cast<std::size_t>(BIG_SIZE / 2));
+
+  for (int i = 0; i < BIG_SIZE / 2; ++i) {
+    EXPECT_EQ(array_get(&a, i), i);
   }
 
+  array_push_back(&a, 42);
+  EXPECT_EQ(array_get(&a, BIG_SIZE / 2), 42);
+
   array_destroy(&a);
 }
 
-TEST(ArrayPartitionTest, WholeNotSorted) {
-  static const int origin[] = { 5, 4, 1, 6, 10, 3, 0, 9, 8, 2, 7 };
+TEST(ArrayShrinkToFitTest, BackToInline) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
 
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
-
-  ptrdiff_t p = array_partition(&a, 0, std::size(origin) - 1);
-  int pivot = array_get(&a, p);
+  array_create(&a);
 
-  for (ptrdiff_t i = 0; i < p; ++i) {
-    EXPECT_LT(array_get(&a, i), pivot);
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    array_push_back(&a, i);
   }
 
-  for (ptrdiff_t i = p + 1; i < static_cast<ptrdiff_t>(std::size(origin)); ++i) {
-    EXPECT_GT(array_get(&a, i), pivot);
-  }
+  array_assign(&a, origin, std::size(origin));
+  array_shrink_to_fit(&a);
 
-  for (int val : origin) {
-    EXPECT_NE(array_search(&a, val), std::size(origin));
-  }
+  EXPECT_EQ(a.data, a.inline_data);
+  EXPECT_EQ(a.capacity, static_cast<std::size_t>(ARRAY_SMALL_CAPACITY));
+  EXPECT_TRUE(array_equals(&a, origin, std::size(origin)));
 
   array_destroy(&a);
 }
 
-TEST(ArrayPartitionTest, PartNotSorted) {
-  static const int origin[] = { 5, 4, 1, 6, 10, 3, 0, 9, 8, 2, 7 };
-
+TEST(ArrayShrinkToFitTest, Empty) {
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  array_create(&a);
 
-  ptrdiff_t p = array_partition(&a, 3, 8);
-  int pivot = array_get(&a, p);
+  array_shrink_to_fit(&a);
 
-  for (ptrdiff_t i = 3; i < p; ++i) {
-    EXPECT_LT(array_get(&a, i), pivot);
+  EXPECT_TRUE(array_empty(&a));
+  EXPECT_EQ(a.capacity, static_cast<std::size_t>(ARRAY_SMALL_CAPACITY));
+
+  array_push_back(&a, 42);
+  EXPECT_EQ(array_get(&a, 0), 42);
+
+  array_destroy(&a);
+}
+
+/*
+ * array small buffer
+ */
+
+TEST(ArraySmallBufferTest, Inline) {
+  struct array a;
+  array_create(&a);
+
+  for (int i = 0; i < ARRAY_SMALL_CAPACITY; ++i) {
+    array_push_back(&a, i);
+    EXPECT_EQ(a.data, a.inline_data);
+  }
+
+  array_push_back(&a, ARRAY_SMALL_CAPACITY); // spill to the heap
+  EXPECT_NE(a.data, a.inline_data);
+
+  for (int i = 0; i <= ARRAY_SMALL_CAPACITY; ++i) {
+    EXPECT_EQ(array_get(&a, i), i);
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArraySmallBufferTest, BackAndForth) {
+  struct array a;
+  array_create(&a);
+
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < BIG_SIZE; ++i) {
+      array_push_back(&a, i);
+    }
+
+    while (array_size(&a) > 2) {
+      array_pop_back(&a);
+    }
+
+    EXPECT_EQ(a.data, a.inline_data);
+    EXPECT_EQ(array_get(&a, 0), 0);
+    EXPECT_EQ(array_get(&a, 1), 1);
+  }
+
+  array_destroy(&a);
+}
+
+/*
+ * array capacity management
+ */
+
+TEST(ArrayCapacityTest, GeometricGrowth) {
+  struct array a;
+  array_create(&a);
+
+  std::size_t reallocations = 0;
+  std::size_t capacity = a.capacity;
+
+  for (int i = 0; i < BIG_SIZE * 100; ++i) {
+    array_push_back(&a, i);
+
+    if (a.capacity != capacity) {
+      ++reallocations;
+      capacity = a.capacity;
+    }
+  }
+
+  EXPECT_LE(reallocations, 20u);
+
+  array_destroy(&a);
+}
+
+TEST(ArrayCapacityTest, GrowthFactor) {
+  struct array a;
+  array_create(&a);
+  array_set_growth_factor(&a, 1.5);
+
+  for (std::size_t i = 0; i <= ARRAY_INITIAL_CAPACITY; ++i) {
+    array_push_back(&a, 0);
+  }
+
+  EXPECT_EQ(a.capacity, static_cast<std::size_t>(ARRAY_INITIAL_CAPACITY * 3 / 2));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayCapacityTest, InvalidGrowthFactor) {
+  // Refuses the huge blocks instead of asking the system for them
+  struct allocator allocator = {
+    [](void *, std::size_t size) { return size > (1u << 20) ? nullptr : std::malloc(size); },
+    [](void *, void *ptr, std::size_t, std::size_t size) { return size > (1u << 20) ? nullptr : std::realloc(ptr, size); },
+    [](void *, void *ptr, std::size_t) { std::free(ptr); },
+    nullptr
+  };
+
+  struct array a;
+  array_create_with(&a, &allocator);
+
+  array_set_growth_factor(&a, std::nan(""));
+  array_set_growth_factor(&a, INFINITY);
+  array_set_growth_factor(&a, 1.0);
+  EXPECT_EQ(a.growth_factor, ARRAY_DEFAULT_GROWTH_FACTOR);
+
+  // The grown capacity is too big for size_t, it is clamped and the allocation fails cleanly
+  array_set_growth_factor(&a, 1e300);
+  for (std::size_t i = 0; i <= ARRAY_INITIAL_CAPACITY; ++i) {
+    array_push_back(&a, static_cast<int>(i));
+  }
+  EXPECT_EQ(array_size(&a), static_cast<std::size_t>(ARRAY_INITIAL_CAPACITY));
+  EXPECT_EQ(a.capacity, static_cast<std::size_t>(ARRAY_INITIAL_CAPACITY));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayCapacityTest, AutomaticShrink) {
+  struct array a;
+  array_create(&a);
+
+  for (int i = 0; i < BIG_SIZE * 100; ++i) {
+    array_push_back(&a, i);
+  }
+
+  std::size_t peak = a.capacity;
+
+  for (int i = 0; i < BIG_SIZE * 100 - 10; ++i) {
+    array_pop_back(&a);
+    EXPECT_LE(array_size(&a), a.capacity);
+  }
+
+  EXPECT_LT(a.capacity, peak);
+  EXPECT_GE(a.capacity, array_size(&a));
+
+  for (std::size_t i = 0; i < array_size(&a); ++i) {
+    EXPECT_EQ(array_get(&a, i), static_cast<int>(i));
+  }
+
+  array_destroy(&a);
+}
+
+/*
+ * array_get
+ */
+
+TEST(ArrayGetTest, ValidIndex) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  for (std::size_t i = 0; i < std::size(origin); ++i) {
+    EXPECT_EQ(array_get(&a, i), origin[i]);
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayGetTest, NotValidIndex) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_EQ(array_get(&a, std::size(origin)), 0);
+  EXPECT_EQ(array_get(&a, -1), 0);
+
+  array_destroy(&a);
+}
+
+/*
+ * array_set
+ */
+
+TEST(ArraySetTest, ValidIndex) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  for (std::size_t i = 0; i < std::size(origin); ++i) {
+    array_set(&a, i, origin[i] - 1);
+    EXPECT_EQ(array_get(&a, i), origin[i] - 1);
+  }
+
+  EXPECT_EQ(array_size(&a), std::size(origin));
+
+  array_destroy(&a);
+}
+
+TEST(ArraySetTest, NotValidIndex) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  array_set(&a, std::size(origin), 42);
+  array_set(&a, -1, 42);
+
+  EXPECT_EQ(array_size(&a), std::size(origin));
+
+  for (std::size_t i = 0; i < std::size(origin); ++i) {
+    EXPECT_EQ(array_get(&a, i), origin[i]);
+  }
+
+  array_destroy(&a);
+}
+
+/*
+ * array_search
+ */
+
+TEST(ArraySearchTest, Present) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  for (size_t i = 0; i < std::size(origin); ++i) {
+    size_t index = array_search(&a, origin[i]);
+    EXPECT_EQ(index, i);
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArraySearchTest, NotPresent) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  size_t index = array_search(&a, -1);
+  EXPECT_EQ(index, std::size(origin));
+
+  array_destroy(&a);
+}
+
+TEST(ArraySearchTest, EveryPosition) {
+  int origin[100];
+
+  for (int i = 0; i < 100; ++i) {
+    origin[i] = i % 50;
+  }
+
+  // Every kernel, whatever the CPU picks by default
+  for (enum array_simd level : simd_levels) {
+    SCOPED_TRACE(level);
+    array_set_simd(level);
+
+    struct array a;
+    array_create_from(&a, origin, std::size(origin));
+
+    for (std::size_t size = 0; size <= std::size(origin); ++size) {
+      a.size = size;
+
+      for (int value = 0; value < 50; ++value) {
+        std::size_t expected = static_cast<std::size_t>(value) < size ? value : size;
+        EXPECT_EQ(array_search(&a, value), expected);
+      }
+
+      EXPECT_EQ(array_search(&a, 50), size);
+    }
+
+    array_destroy(&a);
+  }
+  array_set_simd(ARRAY_SIMD_AUTO);
+}
+
+/*
+ * array_search_sorted
+ */
+
+TEST(ArraySearchSortedTest, Present) {
+  static const int origin[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  for (size_t i = 0; i < std::size(origin); ++i) {
+    size_t index = array_search_sorted(&a, origin[i]);
+    EXPECT_EQ(index, i);
+  }
+
+  array_destroy(&a);
+}
+
+
+TEST(ArraySearchSortedTest, NotPresentBefore) {
+  static const int origin[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  size_t index = array_search_sorted(&a, -1); // before everything
+  EXPECT_EQ(index, std::size(origin));
+
+  array_destroy(&a);
+}
+
+TEST(ArraySearchSortedTest, NotPresentAfter) {
+  static const int origin[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  size_t index = array_search_sorted(&a, 15); // after everything
+  EXPECT_EQ(index, std::size(origin));
+
+  array_destroy(&a);
+}
+
+TEST(ArraySearchSortedTest, NotPresentMiddle) {
+  static const int origin[] = { 1, 2, 3, 5, 6, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  size_t index = array_search_sorted(&a, 4); // in the middle of other elements
+  EXPECT_EQ(index, std::size(origin));
+
+  array_destroy(&a);
+}
+
+/*
+ * array_search_sorted_batch
+ */
+
+TEST(ArraySearchSortedBatchTest, Mixed) {
+  static const int origin[] = { 1, 3, 5, 7, 9, 11, 13 };
+  static const int keys[] = { 0, 1, 4, 7, 13, 14, 9, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  std::size_t out[std::size(keys)];
+  array_search_sorted_batch(&a, keys, std::size(keys), out);
+
+  for (std::size_t i = 0; i < std::size(keys); ++i) {
+    EXPECT_EQ(out[i], array_search_sorted(&a, keys[i]));
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArraySearchSortedBatchTest, Empty) {
+  static const int keys[] = { 0, 1 };
+
+  struct array a;
+  array_create(&a);
+
+  std::size_t out[std::size(keys)];
+  array_search_sorted_batch(&a, keys, std::size(keys), out);
+
+  EXPECT_EQ(out[0], 0u);
+  EXPECT_EQ(out[1], 0u);
+
+  array_search_sorted_batch(&a, keys, 0, out);
+
+  array_destroy(&a);
+}
+
+TEST(ArraySearchSortedBatchTest, Stressed) {
+  struct array a;
+  array_create(&a);
+
+  std::srand(0);
+
+  // Duplicates included, the batch must find the same index as the single search
+  for (int i = 0; i < BIG_SIZE * 10; ++i) {
+    array_push_back(&a, std::rand() % (BIG_SIZE * 5));
+  }
+
+  array_quick_sort(&a);
+
+  int keys[BIG_SIZE + 7];
+  std::size_t out[BIG_SIZE + 7];
+
+  for (std::size_t i = 0; i < std::size(keys); ++i) {
+    keys[i] = std::rand() % (BIG_SIZE * 6) - BIG_SIZE / 2;
+  }
+
+  array_search_sorted_batch(&a, keys, std::size(keys), out);
+
+  for (std::size_t i = 0; i < std::size(keys); ++i) {
+    EXPECT_EQ(out[i], array_search_sorted(&a, keys[i]));
+  }
+
+  array_destroy(&a);
+}
+
+/*
+ * array_build_eytzinger
+ */
+
+TEST(EytzingerSearchTest, Present) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  struct eytzinger e;
+  array_build_eytzinger(&a, &e);
+
+  for (std::size_t i = 0; i < std::size(origin); ++i) {
+    EXPECT_EQ(eytzinger_search(&e, origin[i]), i);
+  }
+
+  // The prefetched groups data[16 * k..] start a cache line
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(e.data) % 64, 0u);
+
+  eytzinger_destroy(&e);
+  array_destroy(&a);
+}
+
+TEST(EytzingerSearchTest, NotPresent) {
+  static const int origin[] = { 1, 3, 5, 7, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  struct eytzinger e;
+  array_build_eytzinger(&a, &e);
+
+  EXPECT_EQ(eytzinger_search(&e, 0), std::size(origin));
+  EXPECT_EQ(eytzinger_search(&e, 4), std::size(origin));
+  EXPECT_EQ(eytzinger_search(&e, 10), std::size(origin));
+
+  eytzinger_destroy(&e);
+  array_destroy(&a);
+}
+
+TEST(EytzingerSearchTest, Empty) {
+  struct array a;
+  array_create(&a);
+
+  struct eytzinger e;
+  array_build_eytzinger(&a, &e);
+
+  EXPECT_EQ(eytzinger_search(&e, 0), 0u);
+  EXPECT_EQ(eytzinger_lower_bound(&e, 0), 0u);
+
+  eytzinger_destroy(&e);
+  array_destroy(&a);
+}
+
+TEST(EytzingerSearchTest, Allocator) {
+  counting_allocator_stats stats;
+  struct allocator allocator = { counting_allocate, counting_reallocate, counting_deallocate, &stats };
+
+  struct array a;
+  array_create_with(&a, &allocator);
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    array_push_back(&a, i);
+  }
+  std::size_t arrayBytes = stats.allocated;
+
+  struct eytzinger e;
+  array_build_eytzinger(&a, &e);
+  EXPECT_GT(stats.allocated, arrayBytes + BIG_SIZE * (sizeof(int) + sizeof(std::size_t)));
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(e.data) % 64, 0u);
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    EXPECT_EQ(eytzinger_search(&e, i), static_cast<std::size_t>(i));
+  }
+
+  eytzinger_destroy(&e);
+  EXPECT_EQ(stats.allocated, arrayBytes);
+
+  array_destroy(&a);
+  EXPECT_EQ(stats.allocated, 0u);
+}
+
+TEST(EytzingerLowerBoundTest, Stressed) {
+  struct array a;
+  array_create(&a);
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    array_push_back(&a, 2 * i);
+  }
+
+  for (std::size_t size = 0; size <= 100; ++size) {
+    a.size = size;
+
+    struct eytzinger e;
+    array_build_eytzinger(&a, &e);
+
+    for (int value = -1; value <= 2 * static_cast<int>(size); ++value) {
+      std::size_t expected = value <= 0 ? 0 : (value + 1) / 2;
+      if (expected > size) expected = size;
+      EXPECT_EQ(eytzinger_lower_bound(&e, value), expected);
+      EXPECT_EQ(eytzinger_search(&e, value), value % 2 == 0 && expected < size ? expected : size);
+    }
+
+    eytzinger_destroy(&e);
+  }
+
+  a.size = BIG_SIZE;
+  struct eytzinger e;
+  array_build_eytzinger(&a, &e);
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    EXPECT_EQ(eytzinger_search(&e, 2 * i), array_search_sorted(&a, 2 * i));
+  }
+
+  eytzinger_destroy(&e);
+  array_destroy(&a);
+}
+
+/*
+ * array_is_sorted
+ */
+
+TEST(ArrayIsSortedTest, Empty) {
+  struct array a;
+  array_create(&a);
+
+  EXPECT_TRUE(array_is_sorted(&a));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayIsSortedTest, Sorted) {
+  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_TRUE(array_is_sorted(&a));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayIsSortedTest, NotSorted) {
+  static const int origin[] = { 0, 1, 2, 3, 4, 5, 10, 9, 8, 7, 6 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_FALSE(array_is_sorted(&a));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayIsSortedTest, NotSortedAtTheEnd) {
+  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_FALSE(array_is_sorted(&a));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayIsSortedTest, EveryPosition) {
+  int origin[100];
+
+  for (int i = 0; i < 100; ++i) {
+    origin[i] = 2 * i;
+  }
+
+  // Every kernel, whatever the CPU picks by default
+  for (enum array_simd level : simd_levels) {
+    SCOPED_TRACE(level);
+    array_set_simd(level);
+
+    struct array a;
+    array_create_from(&a, origin, std::size(origin));
+
+    for (std::size_t size = 0; size <= std::size(origin); ++size) {
+      a.size = size;
+      EXPECT_TRUE(array_is_sorted(&a));
+
+      for (std::size_t i = 1; i < size; ++i) {
+        a.data[i] = a.data[i - 1] - 1;
+        EXPECT_FALSE(array_is_sorted(&a));
+        a.data[i] = origin[i];
+      }
+    }
+
+    array_destroy(&a);
+  }
+  array_set_simd(ARRAY_SIMD_AUTO);
+}
+
+/*
+ * array_partition
+ */
+
+TEST(ArrayPartitionTest, WholeSorted) {
+  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  ptrdiff_t p = array_partition(&a, 0, std::size(origin) - 1);
+  int pivot = array_get(&a, p);
+
+  for (ptrdiff_t i = 0; i < p; ++i) {
+    EXPECT_LT(array_get(&a, i), pivot);
+  }
+
+  for (ptrdiff_t i = p + 1; i < static_cast<ptrdiff_t>(std::size(origin)); ++i) {
+    EXPECT_GT(array_get(&a, i), pivot);
+  }
+
+  for (int val : origin) {
+    EXPECT_NE(array_search(&a, val), std::size(origin));
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayPartitionTest, WholeNotSorted) {
+  static const int origin[] = { 5, 4, 1, 6, 10, 3, 0, 9, 8, 2, 7 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  ptrdiff_t p = array_partition(&a, 0, std::size(origin) - 1);
+  int pivot = array_get(&a, p);
+
+  for (ptrdiff_t i = 0; i < p; ++i) {
+    EXPECT_LT(array_get(&a, i), pivot);
+  }
+
+  for (ptrdiff_t i = p + 1; i < static_cast<ptrdiff_t>(std::size(origin)); ++i) {
+    EXPECT_GT(array_get(&a, i), pivot);
+  }
+
+  for (int val : origin) {
+    EXPECT_NE(array_search(&a, val), std::size(origin));
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayPartitionTest, PartNotSorted) {
+  static const int origin[] = { 5, 4, 1, 6, 10, 3, 0, 9, 8, 2, 7 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  ptrdiff_t p = array_partition(&a, 3, 8);
+  int pivot = array_get(&a, p);
+
+  for (ptrdiff_t i = 3; i < p; ++i) {
+    EXPECT_LT(array_get(&a, i), pivot);
   }
 
   for (ptrdiff_t i = p + 1; i < 8; ++i) {
@@ -588,77 +1475,364 @@ TEST(ArrayPartitionTest, Single) {
 
   ptrdiff_t p = array_partition(&a, 5, 5);
 
-  EXPECT_EQ(p, 5);
+  EXPECT_EQ(p, 5);
+
+  for (int val : origin) {
+    EXPECT_NE(array_search(&a, val), std::size(origin));
+  }
+
+  array_destroy(&a);
+}
+
+/*
+ * array_quick_sort
+ */
+
+TEST(ArrayQuickSortTest, NotSorted) {
+  static const int origin[] = { 8, 4, 1, 6, 10, 3, 0, 9, 5, 2, 7 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_FALSE(array_is_sorted(&a));
+
+  array_quick_sort(&a);
+
+  EXPECT_TRUE(array_is_sorted(&a));
+  EXPECT_EQ(array_size(&a), std::size(origin));
+
+  for (int val : origin) {
+    EXPECT_NE(array_search(&a, val), std::size(origin));
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayQuickSortTest, SortedBackward) {
+  static const int origin[] = { 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_FALSE(array_is_sorted(&a));
+
+  array_quick_sort(&a);
+
+  EXPECT_TRUE(array_is_sorted(&a));
+  EXPECT_EQ(array_size(&a), std::size(origin));
+
+  for (int val : origin) {
+    EXPECT_NE(array_search(&a, val), std::size(origin));
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayQuickSortTest, Sorted) {
+  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_TRUE(array_is_sorted(&a));
+
+  array_quick_sort(&a);
+
+  EXPECT_TRUE(array_is_sorted(&a));
+  EXPECT_EQ(array_size(&a), std::size(origin));
+
+  for (int val : origin) {
+    EXPECT_NE(array_search(&a, val), std::size(origin));
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayQuickSortTest, SortedStressed) {
+  struct array a;
+  array_create(&a);
+
+  for (int i = 0; i < BIG_SIZE * 1000; ++i) {
+    array_push_back(&a, i);
+  }
+
+  array_quick_sort(&a);
+
+  EXPECT_TRUE(array_is_sorted(&a));
+  EXPECT_EQ(array_size(&a), static_cast<std::size_t>(BIG_SIZE * 1000));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayQuickSortTest, SortedBackwardStressed) {
+  struct array a;
+  array_create(&a);
+
+  for (int i = 0; i < BIG_SIZE * 1000; ++i) {
+    array_push_back(&a, BIG_SIZE * 1000 - i);
+  }
+
+  array_quick_sort(&a);
+
+  EXPECT_TRUE(array_is_sorted(&a));
+
+  for (int i = 0; i < BIG_SIZE * 1000; ++i) {
+    EXPECT_EQ(a.data[i], i + 1);
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayQuickSortTest, Duplicates) {
+  struct array a;
+  array_create(&a);
+
+  std::srand(0);
+
+  for (int i = 0; i < BIG_SIZE * 100; ++i) {
+    array_push_back(&a, std::rand() % 4);
+  }
+
+  array_quick_sort(&a);
+
+  EXPECT_TRUE(array_is_sorted(&a));
+  EXPECT_EQ(array_size(&a), static_cast<std::size_t>(BIG_SIZE * 100));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayQuickSortTest, RandomStressed) {
+  struct array a;
+  array_create(&a);
+
+  std::srand(0);
+  long long sum = 0;
+
+  for (int i = 0; i < BIG_SIZE * 100; ++i) {
+    int value = std::rand() - RAND_MAX / 2;
+    sum += value;
+    array_push_back(&a, value);
+  }
+
+  array_quick_sort(&a);
+
+  EXPECT_TRUE(array_is_sorted(&a));
+
+  for (std::size_t i = 0; i < array_size(&a); ++i) {
+    sum -= a.data[i];
+  }
+
+  EXPECT_EQ(sum, 0);
+
+  array_destroy(&a);
+}
+
+/*
+ * array_radix_sort
+ */
+
+TEST(ArrayRadixSortTest, NotSorted) {
+  static const int origin[] = { 8, 4, 1, 6, 10, 3, 0, 9, 5, 2, 7 };
+  static const int expected[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  array_radix_sort(&a);
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayRadixSortTest, Negative) {
+  static const int origin[] = { 8, -4, 1, INT_MIN, -10, 3, 0, INT_MAX, -5, 2, -1 };
+  static const int expected[] = { INT_MIN, -10, -5, -4, -1, 0, 1, 2, 3, 8, INT_MAX };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  array_radix_sort(&a);
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayRadixSortTest, SameHighDigits) {
+  static const int origin[] = { 1000, 7, 300, 42, 1, 2047, 0 };
+  static const int expected[] = { 0, 1, 7, 42, 300, 1000, 2047 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  array_radix_sort(&a);
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayRadixSortTest, Stressed) {
+  struct array a;
+  struct array b;
+  struct array scratch;
+  array_create(&a);
+  array_create(&scratch);
+
+  std::srand(0);
+
+  for (int i = 0; i < BIG_SIZE * 100; ++i) {
+    array_push_back(&a, std::rand() - RAND_MAX / 2);
+  }
+
+  array_create_from(&b, a.data, a.size);
+
+  array_radix_sort_with(&a, &scratch);
+  array_quick_sort(&b);
+
+  EXPECT_TRUE(array_equals(&a, b.data, b.size));
+
+  // The scratch buffer can be reused
+  array_radix_sort_with(&b, &scratch);
+  EXPECT_TRUE(array_equals(&a, b.data, b.size));
+
+  array_destroy(&a);
+  array_destroy(&b);
+  array_destroy(&scratch);
+}
+
+/*
+ * array_parallel_sort
+ */
+
+TEST(ArrayParallelSortTest, Small) {
+  static const int origin[] = { 8, 4, 1, 6, 10, 3, 0, 9, 5, 2, 7 };
+  static const int expected[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  array_parallel_sort(&a, 4);
+
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+
+  array_destroy(&a);
+}
+
+TEST(ArrayParallelSortTest, Stressed) {
+  struct array a;
+  struct array b;
+  array_create(&a);
+
+  std::srand(0);
+
+  for (int i = 0; i < BIG_SIZE * 1000; ++i) {
+    array_push_back(&a, std::rand() - RAND_MAX / 2);
+  }
+
+  array_create_from(&b, a.data, a.size);
+
+  array_parallel_sort(&a, 8);
+  array_quick_sort(&b);
 
-  for (int val : origin) {
-    EXPECT_NE(array_search(&a, val), std::size(origin));
-  }
+  EXPECT_TRUE(array_equals(&a, b.data, b.size));
 
   array_destroy(&a);
+  array_destroy(&b);
 }
 
-/*
- * array_quick_sort
- */
-
-TEST(ArrayQuickSortTest, NotSorted) {
-  static const int origin[] = { 8, 4, 1, 6, 10, 3, 0, 9, 5, 2, 7 };
-
+TEST(ArrayParallelSortTest, Duplicates) {
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  array_create(&a);
 
-  EXPECT_FALSE(array_is_sorted(&a));
+  std::srand(0);
 
-  array_quick_sort(&a);
+  for (int i = 0; i < BIG_SIZE * 1000; ++i) {
+    array_push_back(&a, std::rand() % 3);
+  }
+
+  std::size_t buckets[8];
+  array_parallel_sort_profile(&a, 8, buckets);
 
   EXPECT_TRUE(array_is_sorted(&a));
-  EXPECT_EQ(array_size(&a), std::size(origin));
+  EXPECT_EQ(array_size(&a), static_cast<std::size_t>(BIG_SIZE * 1000));
 
-  for (int val : origin) {
-    EXPECT_NE(array_search(&a, val), std::size(origin));
+  // Only 3 values, but the work is still shared between the threads
+  for (std::size_t size : buckets) {
+    EXPECT_LE(size, array_size(&a) / 4);
   }
 
   array_destroy(&a);
 }
 
-TEST(ArrayQuickSortTest, SortedBackward) {
-  static const int origin[] = { 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
-
+TEST(ArrayParallelSortTest, Skewed) {
   struct array a;
-  array_create_from(&a, origin, std::size(origin));
+  struct array b;
+  array_create(&a);
 
-  EXPECT_FALSE(array_is_sorted(&a));
+  std::srand(0);
 
-  array_quick_sort(&a);
+  for (int i = 0; i < BIG_SIZE * 1000; ++i) {
+    int value = std::rand();
+    array_push_back(&a, value % 10 == 0 ? value - RAND_MAX / 2 : 42); // 90% of 42
+  }
 
-  EXPECT_TRUE(array_is_sorted(&a));
-  EXPECT_EQ(array_size(&a), std::size(origin));
+  array_create_from(&b, a.data, a.size);
 
-  for (int val : origin) {
-    EXPECT_NE(array_search(&a, val), std::size(origin));
+  std::size_t buckets[8];
+  array_parallel_sort_profile(&a, 8, buckets);
+  array_quick_sort(&b);
+
+  EXPECT_TRUE(array_equals(&a, b.data, b.size));
+  for (std::size_t size : buckets) {
+    EXPECT_LE(size, array_size(&a) / 4);
   }
 
   array_destroy(&a);
+  array_destroy(&b);
 }
 
-TEST(ArrayQuickSortTest, Sorted) {
-  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+TEST(ArrayParallelSortTest, ProfileNoThreads) {
+  static const int origin[] = { 3, 1, 2 };
+  static const int expected[] = { 1, 2, 3 };
 
   struct array a;
   array_create_from(&a, origin, std::size(origin));
 
-  EXPECT_TRUE(array_is_sorted(&a));
+  // No room at all: nothing must be written
+  std::size_t canary = 42;
+  array_parallel_sort_profile(&a, 0, &canary);
 
-  array_quick_sort(&a);
+  EXPECT_TRUE(array_equals(&a, expected, std::size(expected)));
+  EXPECT_EQ(canary, 42u);
 
-  EXPECT_TRUE(array_is_sorted(&a));
-  EXPECT_EQ(array_size(&a), std::size(origin));
+  array_destroy(&a);
+}
 
-  for (int val : origin) {
-    EXPECT_NE(array_search(&a, val), std::size(origin));
+TEST(ArrayParallelSortTest, Allocator) {
+  counting_allocator_stats stats;
+  struct allocator allocator = { counting_allocate, counting_reallocate, counting_deallocate, &stats };
+
+  struct array a;
+  array_create_with(&a, &allocator);
+
+  std::srand(0);
+
+  for (int i = 0; i < BIG_SIZE * 1000; ++i) {
+    array_push_back(&a, std::rand());
   }
+  std::size_t calls = stats.calls;
+
+  array_parallel_sort(&a, 8);
+
+  EXPECT_TRUE(array_is_sorted(&a));
+  // The scratch buffer and the bookkeeping come from the allocator and are given back
+  EXPECT_GT(stats.calls, calls);
+  EXPECT_EQ(stats.allocated, a.capacity * sizeof(int));
 
   array_destroy(&a);
+  EXPECT_EQ(stats.allocated, 0u);
 }
 
 /*
@@ -725,6 +1899,28 @@ TEST(ArrayHeapSortTest, Sorted) {
   array_destroy(&a);
 }
 
+TEST(ArrayHeapSortTest, Stressed) {
+  struct array a;
+  struct array b;
+  array_create(&a);
+
+  std::srand(0);
+
+  for (int i = 0; i < BIG_SIZE * 100; ++i) {
+    array_push_back(&a, std::rand() % (BIG_SIZE * 10) - BIG_SIZE * 5);
+  }
+
+  array_create_from(&b, a.data, a.size);
+
+  array_heap_sort(&a);
+  array_radix_sort(&b);
+
+  EXPECT_TRUE(array_equals(&a, b.data, b.size));
+
+  array_destroy(&a);
+  array_destroy(&b);
+}
+
 /*
  * array_is_heap
  */
@@ -800,6 +1996,106 @@ TEST(ArrayHeapAddTest, Stressed) {
   array_destroy(&a);
 }
 
+/*
+ * array_heap_build
+ */
+
+TEST(ArrayHeapBuildTest, NotHeap) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_FALSE(array_is_heap(&a));
+
+  array_heap_build(&a);
+
+  EXPECT_TRUE(array_is_heap(&a));
+  EXPECT_EQ(array_heap_top(&a), 9);
+  EXPECT_EQ(array_size(&a), std::size(origin));
+
+  for (int val : origin) {
+    EXPECT_NE(array_search(&a, val), std::size(origin));
+  }
+
+  array_destroy(&a);
+}
+
+TEST(ArrayHeapBuildTest, Stressed) {
+  static const std::size_t arities[] = { 2, 4, 8 };
+
+  for (std::size_t arity : arities) {
+    struct array a;
+    array_create(&a);
+    array_set_heap_arity(&a, arity);
+
+    for (int i = 0; i < BIG_SIZE; ++i) {
+      array_push_back(&a, i);
+    }
+
+    array_heap_build(&a);
+
+    EXPECT_TRUE(array_is_heap(&a));
+    EXPECT_EQ(array_heap_top(&a), BIG_SIZE - 1);
+
+    array_destroy(&a);
+  }
+}
+
+/*
+ * array_heap_add_bulk
+ */
+
+TEST(ArrayHeapAddBulkTest, Small) {
+  static const int values[] = { 3, 42, 7 };
+
+  struct array a;
+  array_create(&a);
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    array_heap_add(&a, i);
+  }
+
+  array_heap_add_bulk(&a, values, std::size(values));
+
+  EXPECT_TRUE(array_is_heap(&a));
+  EXPECT_EQ(array_size(&a), BIG_SIZE + std::size(values));
+  EXPECT_EQ(array_heap_top(&a), BIG_SIZE - 1);
+
+  array_destroy(&a);
+}
+
+TEST(ArrayHeapAddBulkTest, Large) {
+  int values[BIG_SIZE];
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    values[i] = i;
+  }
+
+  struct array a;
+  array_create(&a);
+
+  array_heap_add(&a, 10);
+  array_heap_add_bulk(&a, values, std::size(values));
+
+  EXPECT_TRUE(array_is_heap(&a));
+  EXPECT_EQ(array_size(&a), static_cast<std::size_t>(BIG_SIZE + 1));
+
+  for (int i = BIG_SIZE - 1; i >= 0; --i) {
+    EXPECT_EQ(array_heap_top(&a), i);
+    array_heap_remove_top(&a);
+
+    if (i == 10) {
+      EXPECT_EQ(array_heap_top(&a), 10);
+      array_heap_remove_top(&a);
+    }
+  }
+
+  EXPECT_TRUE(array_empty(&a));
+
+  array_destroy(&a);
+}
+
 /*
  * array_heap_remove_top
  */
@@ -829,6 +2125,184 @@ for (int i = 0; i < BIG_SIZE; ++i) {
 }
 
 
+/*
+ * array_set_heap_arity
+ */
+
+TEST(ArrayHeapArityTest, IsHeap) {
+  static const int origin[] = { 9, 5, 6, 7, 8, 1, 2, 3, 4 };
+
+  struct array a;
+  array_create_from(&a, origin, std::size(origin));
+
+  EXPECT_FALSE(array_is_heap(&a));
+
+  array_set_heap_arity(&a, 4);
+  EXPECT_TRUE(array_is_heap(&a));
+
+  array_set_heap_arity(&a, 1); // not valid
+  EXPECT_EQ(a.heap_arity, 4u);
+
+  array_destroy(&a);
+}
+
+TEST(ArrayHeapArityTest, Stressed) {
+  static const std::size_t arities[] = { 2, 3, 4, 8, 16 };
+
+  for (std::size_t arity : arities) {
+    struct array a;
+    array_create(&a);
+    array_set_heap_arity(&a, arity);
+
+    std::srand(0);
+
+    for (int i = 0; i < BIG_SIZE; ++i) {
+      array_heap_add(&a, std::rand() % BIG_SIZE);
+      EXPECT_TRUE(array_is_heap(&a));
+    }
+
+    int previous = array_heap_top(&a);
+
+    for (int i = 0; i < BIG_SIZE; ++i) {
+      EXPECT_LE(array_heap_top(&a), previous);
+      previous = array_heap_top(&a);
+      array_heap_remove_top(&a);
+      EXPECT_TRUE(array_is_heap(&a));
+    }
+
+    EXPECT_TRUE(array_empty(&a));
+
+    array_destroy(&a);
+  }
+}
+
+/*
+ * indexed_heap
+ */
+
+TEST(IndexedHeapPushTest, ManyElements) {
+  struct indexed_heap h;
+  indexed_heap_create(&h);
+
+  EXPECT_TRUE(indexed_heap_empty(&h));
+  EXPECT_EQ(indexed_heap_top(&h), INDEXED_HEAP_NONE);
+
+  EXPECT_TRUE(indexed_heap_push(&h, 3, 30));
+  EXPECT_TRUE(indexed_heap_push(&h, 7, 70));
+  EXPECT_TRUE(indexed_heap_push(&h, 1, 10));
+  EXPECT_FALSE(indexed_heap_push(&h, 7, 5)); // already present
+
+  EXPECT_EQ(indexed_heap_size(&h), 3u);
+  EXPECT_EQ(indexed_heap_top(&h), 7u);
+  EXPECT_EQ(indexed_heap_priority(&h, 7), 70);
+  EXPECT_TRUE(indexed_heap_contains(&h, 1));
+  EXPECT_FALSE(indexed_heap_contains(&h, 2));
+  EXPECT_FALSE(indexed_heap_contains(&h, 100));
+
+  indexed_heap_destroy(&h);
+}
+
+TEST(IndexedHeapPushTest, SentinelHandle) {
+  struct indexed_heap h;
+  indexed_heap_create(&h);
+
+  EXPECT_FALSE(indexed_heap_push(&h, INDEXED_HEAP_NONE, 5)); // empty heap
+  EXPECT_TRUE(indexed_heap_push(&h, 3, 30));
+  EXPECT_FALSE(indexed_heap_push(&h, INDEXED_HEAP_NONE, 5));
+  EXPECT_FALSE(indexed_heap_push(&h, INDEXED_HEAP_NONE - 1, 5)); // too big to allocate
+
+  EXPECT_EQ(indexed_heap_size(&h), 1u);
+  EXPECT_EQ(indexed_heap_top(&h), 3u);
+
+  indexed_heap_destroy(&h);
+}
+
+TEST(IndexedHeapPushTest, Allocator) {
+  counting_allocator_stats stats;
+  struct allocator allocator = { counting_allocate, counting_reallocate, counting_deallocate, &stats };
+
+  struct indexed_heap h;
+  indexed_heap_create_with(&h, &allocator);
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    EXPECT_TRUE(indexed_heap_push(&h, static_cast<std::size_t>(i), (i * 7) % BIG_SIZE));
+  }
+  EXPECT_GE(stats.allocated, BIG_SIZE * (2 * sizeof(std::size_t) + sizeof(int)));
+  EXPECT_EQ(indexed_heap_top(&h), 857u); // priority BIG_SIZE - 1
+
+  indexed_heap_destroy(&h);
+  EXPECT_EQ(stats.allocated, 0u);
+}
+
+TEST(IndexedHeapKeyTest, DecreaseIncrease) {
+  struct indexed_heap h;
+  indexed_heap_create(&h);
+
+  for (std::size_t i = 0; i < 10; ++i) {
+    indexed_heap_push(&h, i, static_cast<int>(i * 10));
+  }
+
+  EXPECT_EQ(indexed_heap_top(&h), 9u);
+
+  EXPECT_TRUE(indexed_heap_decrease_key(&h, 9, -1));
+  EXPECT_EQ(indexed_heap_top(&h), 8u);
+
+  EXPECT_TRUE(indexed_heap_increase_key(&h, 0, 1000));
+  EXPECT_EQ(indexed_heap_top(&h), 0u);
+
+  EXPECT_FALSE(indexed_heap_decrease_key(&h, 5, 60)); // higher
+  EXPECT_FALSE(indexed_heap_increase_key(&h, 5, 40)); // lower
+  EXPECT_FALSE(indexed_heap_increase_key(&h, 42, 40)); // not present
+  EXPECT_EQ(indexed_heap_priority(&h, 5), 50);
+
+  EXPECT_EQ(indexed_heap_size(&h), 10u);
+
+  indexed_heap_destroy(&h);
+}
+
+TEST(IndexedHeapRemoveTest, Stressed) {
+  struct indexed_heap h;
+  indexed_heap_create(&h);
+
+  std::srand(0);
+  int priorities[BIG_SIZE];
+
+  for (std::size_t i = 0; i < BIG_SIZE; ++i) {
+    priorities[i] = std::rand() % BIG_SIZE;
+    indexed_heap_push(&h, i, priorities[i]);
+  }
+
+  // Remove every third handle and reprioritize the others
+  for (std::size_t i = 0; i < BIG_SIZE; ++i) {
+    if (i % 3 == 0) {
+      EXPECT_TRUE(indexed_heap_remove(&h, i));
+      EXPECT_FALSE(indexed_heap_remove(&h, i));
+    } else if (i % 3 == 1) {
+      priorities[i] -= 100;
+      EXPECT_TRUE(indexed_heap_decrease_key(&h, i, priorities[i]));
+    } else {
+      priorities[i] += 100;
+      EXPECT_TRUE(indexed_heap_increase_key(&h, i, priorities[i]));
+    }
+  }
+
+  EXPECT_EQ(indexed_heap_size(&h), static_cast<std::size_t>(BIG_SIZE - (BIG_SIZE + 2) / 3));
+
+  int previous = indexed_heap_priority(&h, indexed_heap_top(&h));
+
+  while (!indexed_heap_empty(&h)) {
+    std::size_t top = indexed_heap_top(&h);
+    EXPECT_NE(top % 3, 0u);
+    EXPECT_EQ(indexed_heap_priority(&h, top), priorities[top]);
+    EXPECT_LE(priorities[top], previous);
+    previous = priorities[top];
+    indexed_heap_pop(&h);
+    EXPECT_FALSE(indexed_heap_contains(&h, top));
+  }
+
+  indexed_heap_destroy(&h);
+}
+
 /*
  * list_create
  */
@@ -850,31 +2324,90 @@ TEST(ListCreateTest, Empty) {
  * list_create_from
  */
 
-TEST(ListCreateFromTest, OneElement) {
-  static const int origin[] = { 1 };
+TEST(ListCreateFromTest, OneElement) {
+  static const int origin[] = { 1 };
+
+  struct list l;
+  list_create_from(&l, origin, std::size(origin));
+
+  EXPECT_FALSE(list_empty(&l));
+  EXPECT_EQ(list_size(&l), std::size(origin));
+  EXPECT_TRUE(list_equals(&l, origin, std::size(origin)));
+  EXPECT_EQ(l.first, l.last);
+
+
+  list_destroy(&l);
+}
+
+TEST(ListCreateFromTest, ManyElements) {
+  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+
+  struct list l;
+  list_create_from(&l, origin, std::size(origin));
+
+  EXPECT_FALSE(list_empty(&l));
+  EXPECT_EQ(list_size(&l), std::size(origin));
+  EXPECT_TRUE(list_equals(&l, origin, std::size(origin)));
+
+
+  list_destroy(&l);
+}
+
+/*
+ * list node pool
+ */
+
+TEST(ListPoolTest, Contiguous) {
+  struct list l;
+  list_create(&l);
+
+  for (int i = 0; i < 16; ++i) {
+    list_push_back(&l, i);
+  }
+
+  // The nodes are carved one after the other in the same chunk
+  for (struct list_node *curr = l.first; curr->next != nullptr; curr = curr->next) {
+    EXPECT_EQ(curr + 1, curr->next);
+  }
+
+  list_destroy(&l);
+}
+
+TEST(ListPoolTest, Recycled) {
+  struct list l;
+  list_create(&l);
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    list_push_back(&l, i);
+  }
+
+  struct list_node *first = l.first;
+  list_pop_front(&l);
+  list_push_front(&l, 42);
 
-  struct list l;
-  list_create_from(&l, origin, std::size(origin));
+  EXPECT_EQ(l.first, first);
+  EXPECT_EQ(list_get(&l, 0), 42);
+  EXPECT_EQ(list_size(&l), static_cast<std::size_t>(BIG_SIZE));
 
-  EXPECT_FALSE(list_empty(&l));
-  EXPECT_EQ(list_size(&l), std::size(origin));
-  EXPECT_TRUE(list_equals(&l, origin, std::size(origin)));
-  EXPECT_EQ(l.first, l.last);
+  list_destroy(&l);
 
+  EXPECT_TRUE(list_empty(&l));
+
+  // The list can be used again after being destroyed
+  list_push_back(&l, 1);
+  EXPECT_EQ(list_get(&l, 0), 1);
 
   list_destroy(&l);
 }
 
-TEST(ListCreateFromTest, ManyElements) {
-  static const int origin[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+TEST(ListPoolTest, RemoveSingle) {
+  static const int origin[] = { 1 };
 
   struct list l;
   list_create_from(&l, origin, std::size(origin));
 
-  EXPECT_FALSE(list_empty(&l));
-  EXPECT_EQ(list_size(&l), std::size(origin));
-  EXPECT_TRUE(list_equals(&l, origin, std::size(origin)));
-
+  list_remove(&l, 0);
+  EXPECT_TRUE(list_empty(&l));
 
   list_destroy(&l);
 }
@@ -1239,6 +2772,60 @@ TEST(ListRemoveTest, End) {
   list_destroy(&l);
 }
 
+TEST(ListRemoveTest, EndThenPushBack) {
+  static const int origin[] = { 9, 3, 7 };
+  static const int expected[] = { 9, 3, 5 };
+
+  struct list l;
+  list_create_from(&l, origin, std::size(origin));
+
+  list_remove(&l, std::size(origin) - 1);
+  list_push_back(&l, 5); // last must have been updated
+
+  EXPECT_TRUE(list_equals(&l, expected, std::size(expected)));
+  EXPECT_EQ(l.last->data, 5);
+  EXPECT_EQ(l.last->prev->data, 3);
+
+  list_destroy(&l);
+}
+
+/*
+ * list_size
+ */
+
+TEST(ListSizeTest, Mixed) {
+  struct list l;
+  list_create(&l);
+  EXPECT_EQ(list_size(&l), 0u);
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    list_push_back(&l, i);
+    list_push_front(&l, i);
+  }
+  EXPECT_EQ(list_size(&l), static_cast<size_t>(2 * BIG_SIZE));
+
+  list_insert(&l, 42, BIG_SIZE);
+  list_remove(&l, 0);
+  list_pop_back(&l);
+  list_pop_front(&l);
+  EXPECT_EQ(list_size(&l), static_cast<size_t>(2 * BIG_SIZE - 2));
+
+  // Walk backward to check the prev links are consistent with the size
+  size_t count = 0;
+  for (struct list_node *curr = l.last; curr != NULL; curr = curr->prev) {
+    ++count;
+  }
+  EXPECT_EQ(count, list_size(&l));
+
+  while (!list_empty(&l)) {
+    list_pop_back(&l);
+  }
+  EXPECT_EQ(list_size(&l), 0u);
+  EXPECT_TRUE(l.first == NULL);
+
+  list_destroy(&l);
+}
+
 /*
  * list_get
  */
@@ -1559,38 +3146,499 @@ TEST(ListMergeSortTest, SortedBackward) {
   struct list l;
   list_create_from(&l, origin, std::size(origin));
 
-  EXPECT_FALSE(list_is_sorted(&l));
+  EXPECT_FALSE(list_is_sorted(&l));
+
+  list_merge_sort(&l);
+
+  EXPECT_TRUE(list_is_sorted(&l));
+  EXPECT_EQ(list_size(&l), std::size(origin));
+
+  for (int val : origin) {
+    EXPECT_NE(list_search(&l, val), std::size(origin));
+  }
+
+  list_destroy(&l);
+}
+
+TEST(ListMergeSortTest, Sorted) {
+  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+
+  struct list l;
+  list_create_from(&l, origin, std::size(origin));
+
+  EXPECT_TRUE(list_is_sorted(&l));
+
+  list_merge_sort(&l);
+
+  EXPECT_TRUE(list_is_sorted(&l));
+  EXPECT_EQ(list_size(&l), std::size(origin));
+
+  for (int val : origin) {
+    EXPECT_NE(list_search(&l, val), std::size(origin));
+  }
+
+  list_destroy(&l);
+}
+
+TEST(ListMergeSortTest, NoAllocation) {
+  counting_allocator_stats stats;
+  struct allocator allocator = { counting_allocate, counting_reallocate, counting_deallocate, &stats };
+
+  struct list l;
+  list_create_with(&l, &allocator);
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    list_push_back(&l, (i * 7919) % BIG_SIZE);
+  }
+
+  std::size_t calls = stats.calls;
+  list_merge_sort(&l);
+  EXPECT_EQ(stats.calls, calls);
+
+  EXPECT_TRUE(list_is_sorted(&l));
+  EXPECT_EQ(list_size(&l), static_cast<size_t>(BIG_SIZE));
+  EXPECT_EQ(l.first->prev, nullptr);
+  EXPECT_EQ(l.last->data, BIG_SIZE - 1);
+
+  // The nodes still belong to l
+  list_pop_front(&l);
+  list_push_back(&l, BIG_SIZE);
+  EXPECT_EQ(stats.calls, calls);
+
+  list_destroy(&l);
+  EXPECT_EQ(stats.allocated, 0u);
+}
+
+TEST(ListMergeSortTest, SplitThenDestroy) {
+  static const int origin[] = { 8, 4, 1, 6, 10, 3, 0, 9, 5, 2, 7 };
+
+  struct list l;
+  struct list l1;
+  struct list l2;
+  list_create_from(&l, origin, std::size(origin));
+  list_create(&l1);
+  list_create(&l2);
+
+  // The lists share the nodes, each one can be destroyed on its own
+  list_split(&l, &l1, &l2);
+  list_destroy(&l);
+  list_pop_back(&l1);
+  list_push_front(&l1, 11);
+  list_destroy(&l1);
+
+  EXPECT_EQ(list_size(&l2), std::size(origin) - std::size(origin) / 2);
+  EXPECT_EQ(l2.first->data, 3);
+  list_destroy(&l2);
+}
+
+/*
+ * list_merge_sort_bottom_up
+ */
+
+TEST(ListMergeSortBottomUpTest, NotSorted) {
+  counting_allocator_stats stats;
+  struct allocator allocator = { counting_allocate, counting_reallocate, counting_deallocate, &stats };
+
+  struct list l;
+  list_create_with(&l, &allocator);
+  for (int i = 0; i < BIG_SIZE + 3; ++i) {
+    list_push_front(&l, (i * 7919) % BIG_SIZE);
+  }
+
+  std::size_t calls = stats.calls;
+  list_merge_sort_bottom_up(&l);
+  EXPECT_EQ(stats.calls, calls);
+
+  EXPECT_TRUE(list_is_sorted(&l));
+  EXPECT_EQ(list_size(&l), static_cast<size_t>(BIG_SIZE + 3));
+
+  // The prev links follow the new order
+  std::size_t count = 0;
+  int prev = INT_MAX;
+  for (struct list_node *curr = l.last; curr != NULL; curr = curr->prev) {
+    EXPECT_LE(curr->data, prev);
+    prev = curr->data;
+    ++count;
+  }
+  EXPECT_EQ(count, list_size(&l));
+
+  list_destroy(&l);
+}
+
+TEST(ListMergeSortBottomUpTest, Small) {
+  static const int origin[] = { 2, 1, 2, 0, 1 };
+  static const int expected[] = { 0, 1, 1, 2, 2 };
+
+  struct list l;
+  list_create_from(&l, origin, std::size(origin));
+
+  list_merge_sort_bottom_up(&l);
+
+  EXPECT_TRUE(list_equals(&l, expected, std::size(expected)));
+  EXPECT_EQ(l.last->prev->data, 2);
+
+  list_destroy(&l);
+}
+
+/*
+ * list_sort_contiguous
+ */
+
+TEST(ListToArrayTest, RoundTrip) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+  static const int shorter[] = { 1, 2 };
+
+  struct list l;
+  struct array a;
+  list_create_from(&l, origin, std::size(origin));
+  array_create(&a);
+  array_push_back(&a, 42);
+
+  list_to_array(&l, &a);
+  EXPECT_TRUE(array_equals(&a, origin, std::size(origin)));
+
+  struct list_node *first = l.first;
+  list_assign_from_array(&l, shorter, std::size(shorter));
+  EXPECT_TRUE(list_equals(&l, shorter, std::size(shorter)));
+  EXPECT_EQ(l.first, first); // Same nodes
+  EXPECT_EQ(l.last->prev, first);
+
+  list_assign_from_array(&l, origin, std::size(origin));
+  EXPECT_TRUE(list_equals(&l, origin, std::size(origin)));
+
+  array_destroy(&a);
+  list_destroy(&l);
+}
+
+TEST(ListSortContiguousTest, Engines) {
+  counting_allocator_stats stats;
+  struct allocator allocator = { counting_allocate, counting_reallocate, counting_deallocate, &stats };
+
+  // Radix sort, quick sort, then merge sort when the buffer is too small
+  const size_t caps[] = { SIZE_MAX, 3 * BIG_SIZE * sizeof(int) / 2, BIG_SIZE };
+  for (size_t cap : caps) {
+    struct list l;
+    list_create_with(&l, &allocator);
+    for (int i = 0; i < BIG_SIZE; ++i) {
+      list_push_back(&l, (i * 7919) % BIG_SIZE - BIG_SIZE / 2);
+    }
+    struct list_node *first = l.first;
+    std::size_t allocated = stats.allocated;
+
+    list_sort_contiguous(&l, cap);
+
+    EXPECT_EQ(stats.allocated, allocated);
+    EXPECT_TRUE(list_is_sorted(&l));
+    EXPECT_EQ(list_size(&l), static_cast<size_t>(BIG_SIZE));
+    EXPECT_EQ(l.first->data, -BIG_SIZE / 2);
+    if (cap != BIG_SIZE) {
+      EXPECT_EQ(l.first, first); // The values moved, not the nodes
+    }
+
+    list_destroy(&l);
+  }
+  EXPECT_EQ(stats.allocated, 0u);
+}
+
+/*
+ * list_cursor
+ */
+
+TEST(ListCursorTest, Walk) {
+  static const int origin[] = { 9, 3, 7 };
+
+  struct list l;
+  list_create_from(&l, origin, std::size(origin));
+
+  struct list_cursor c;
+  list_cursor_first(&c, &l);
+  for (int val : origin) {
+    ASSERT_TRUE(list_cursor_valid(&c));
+    EXPECT_EQ(list_cursor_get(&c), val);
+    list_cursor_next(&c);
+  }
+  EXPECT_FALSE(list_cursor_valid(&c));
+  EXPECT_EQ(list_cursor_get(&c), 0);
+
+  // Back from past the end
+  list_cursor_prev(&c);
+  EXPECT_EQ(list_cursor_get(&c), 7);
+  list_cursor_last(&c, &l);
+  list_cursor_prev(&c);
+  list_cursor_set(&c, 4);
+  EXPECT_EQ(list_get(&l, 1), 4);
+
+  list_destroy(&l);
+}
+
+TEST(ListCursorTest, EditWhileWalking) {
+  struct list l;
+  list_create(&l);
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    list_push_back(&l, i);
+  }
+
+  // Remove the even values, duplicate the odd ones
+  struct list_cursor c;
+  list_cursor_first(&c, &l);
+  while (list_cursor_valid(&c)) {
+    int val = list_cursor_get(&c);
+    if (val % 2 == 0) {
+      list_cursor_erase(&c);
+    } else {
+      list_cursor_insert_after(&c, val);
+      list_cursor_insert_before(&c, -val);
+      list_cursor_next(&c);
+      list_cursor_next(&c);
+    }
+  }
+  list_cursor_insert_before(&c, BIG_SIZE); // At the end
+
+  EXPECT_EQ(list_size(&l), static_cast<size_t>(3 * BIG_SIZE / 2 + 1));
+  EXPECT_EQ(list_get(&l, 0), -1);
+  EXPECT_EQ(list_get(&l, 1), 1);
+  EXPECT_EQ(list_get(&l, 2), 1);
+  EXPECT_EQ(l.last->data, BIG_SIZE);
+
+  // The prev links are consistent
+  size_t count = 0;
+  for (struct list_node *curr = l.last; curr != NULL; curr = curr->prev) {
+    ++count;
+  }
+  EXPECT_EQ(count, list_size(&l));
+
+  list_destroy(&l);
+}
+
+/*
+ * unrolled_list
+ */
+
+TEST(UnrolledListTest, NodeSize) {
+  EXPECT_LE(sizeof(struct unrolled_list_node), static_cast<size_t>(UNROLLED_LIST_NODE_SIZE));
+  // A full node uses about 4 times less memory per element than struct list_node
+  EXPECT_LE(4 * sizeof(struct unrolled_list_node), UNROLLED_LIST_NODE_CAPACITY * sizeof(struct list_node));
+}
+
+TEST(UnrolledListTest, CreateFrom) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8, 1, 6, 5, 11, 10, 13, 12 };
+
+  struct unrolled_list l;
+  unrolled_list_create_from(&l, origin, std::size(origin));
+
+  EXPECT_FALSE(unrolled_list_empty(&l));
+  EXPECT_EQ(unrolled_list_size(&l), std::size(origin));
+  EXPECT_TRUE(unrolled_list_equals(&l, origin, std::size(origin)));
+  EXPECT_FALSE(unrolled_list_equals(&l, origin, std::size(origin) - 1));
+  EXPECT_FALSE(unrolled_list_is_sorted(&l));
+
+  for (size_t i = 0; i < std::size(origin); ++i) {
+    EXPECT_EQ(unrolled_list_get(&l, i), origin[i]);
+    EXPECT_EQ(unrolled_list_search(&l, origin[i]), i);
+  }
+  EXPECT_EQ(unrolled_list_search(&l, 42), std::size(origin));
+  EXPECT_EQ(unrolled_list_get(&l, std::size(origin)), 0);
+
+  unrolled_list_destroy(&l);
+  EXPECT_TRUE(unrolled_list_empty(&l));
+}
+
+TEST(UnrolledListTest, PushPop) {
+  struct unrolled_list l;
+  unrolled_list_create(&l);
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    unrolled_list_push_back(&l, i);
+    unrolled_list_push_front(&l, -i - 1);
+  }
+  EXPECT_EQ(unrolled_list_size(&l), static_cast<size_t>(2 * BIG_SIZE));
+  EXPECT_TRUE(unrolled_list_is_sorted(&l));
+  EXPECT_EQ(unrolled_list_get(&l, 0), -BIG_SIZE);
+  EXPECT_EQ(unrolled_list_get(&l, 2 * BIG_SIZE - 1), BIG_SIZE - 1);
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    unrolled_list_pop_front(&l);
+    unrolled_list_pop_back(&l);
+  }
+  EXPECT_TRUE(unrolled_list_empty(&l));
+  EXPECT_TRUE(l.first == NULL && l.last == NULL);
+
+  unrolled_list_destroy(&l);
+}
+
+TEST(UnrolledListTest, InsertRemoveStressed) {
+  struct unrolled_list l;
+  struct list ref;
+  unrolled_list_create(&l);
+  list_create(&ref);
+
+  // Insert in the middle to split nodes, then remove to merge them
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    size_t index = (static_cast<size_t>(i) * 7919) % (list_size(&ref) + 1);
+    unrolled_list_insert(&l, i, index);
+    list_insert(&ref, i, index);
+  }
+  for (int i = 0; i < BIG_SIZE / 2; ++i) {
+    size_t index = (static_cast<size_t>(i) * 104729) % list_size(&ref);
+    unrolled_list_remove(&l, index);
+    list_remove(&ref, index);
+  }
+  unrolled_list_set(&l, 0, -1);
+  list_set(&ref, 0, -1);
+
+  ASSERT_EQ(unrolled_list_size(&l), list_size(&ref));
+  size_t i = 0;
+  for (struct list_node *curr = ref.first; curr != NULL; curr = curr->next) {
+    EXPECT_EQ(unrolled_list_get(&l, i++), curr->data);
+  }
+
+  // The nodes are linked both ways and none of them is empty
+  size_t count = 0;
+  for (struct unrolled_list_node *curr = l.last; curr != NULL; curr = curr->prev) {
+    EXPECT_GT(curr->count, 0u);
+    count += curr->count;
+  }
+  EXPECT_EQ(count, unrolled_list_size(&l));
+
+  unrolled_list_destroy(&l);
+  list_destroy(&ref);
+}
+
+TEST(UnrolledListTest, MergeSort) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8, 1, 6, 5, 11, 10, 13, 12 };
+  static const int expected[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13 };
+
+  struct unrolled_list l;
+  unrolled_list_create_from(&l, origin, std::size(origin));
+
+  unrolled_list_merge_sort(&l);
+
+  EXPECT_TRUE(unrolled_list_equals(&l, expected, std::size(expected)));
+
+  unrolled_list_destroy(&l);
+}
+
+TEST(UnrolledListTest, MergeSortStressed) {
+  counting_allocator_stats stats;
+  struct allocator allocator = { counting_allocate, counting_reallocate, counting_deallocate, &stats };
+
+  // Sizes around the node capacity, and nodes only partly filled by the removals
+  for (int size : { 0, 1, 2, static_cast<int>(UNROLLED_LIST_NODE_CAPACITY), static_cast<int>(UNROLLED_LIST_NODE_CAPACITY) + 1, BIG_SIZE }) {
+    struct unrolled_list l;
+    unrolled_list_create_with(&l, &allocator);
+    std::vector<int> expected;
+
+    std::srand(0);
+    for (int i = 0; i < size; ++i) {
+      int value = std::rand() % (BIG_SIZE / 10);
+      unrolled_list_insert(&l, value, static_cast<size_t>(std::rand()) % (unrolled_list_size(&l) + 1));
+      expected.push_back(value);
+    }
+    for (int i = 0; i < size / 3; ++i) {
+      size_t index = static_cast<size_t>(std::rand()) % unrolled_list_size(&l);
+      expected.erase(std::find(expected.begin(), expected.end(), unrolled_list_get(&l, index)));
+      unrolled_list_remove(&l, index);
+    }
+    std::sort(expected.begin(), expected.end());
+
+    unrolled_list_merge_sort(&l);
+
+    EXPECT_TRUE(unrolled_list_is_sorted(&l));
+    EXPECT_TRUE(unrolled_list_equals(&l, expected.data(), expected.size()));
+
+    unrolled_list_destroy(&l);
+  }
+
+  EXPECT_EQ(stats.allocated, 0u);
+}
+
+/*
+ * skip_list
+ */
+
+TEST(SkipListTest, CreateFrom) {
+  static const int origin[] = { 9, 3, 7, 2, 4, 0, 8 };
+
+  struct skip_list l;
+  skip_list_create_from(&l, origin, std::size(origin));
+
+  EXPECT_FALSE(skip_list_empty(&l));
+  EXPECT_EQ(skip_list_size(&l), std::size(origin));
+  EXPECT_TRUE(skip_list_equals(&l, origin, std::size(origin)));
+  EXPECT_FALSE(skip_list_is_sorted(&l));
+
+  for (size_t i = 0; i < std::size(origin); ++i) {
+    EXPECT_EQ(skip_list_get(&l, i), origin[i]);
+  }
+  EXPECT_EQ(skip_list_get(&l, std::size(origin)), 0);
+
+  skip_list_destroy(&l);
+  EXPECT_TRUE(skip_list_empty(&l));
+}
+
+TEST(SkipListTest, PushPop) {
+  static const int expected[] = { 2, 0, 1 };
 
-  list_merge_sort(&l);
+  struct skip_list l;
+  skip_list_create(&l);
 
-  EXPECT_TRUE(list_is_sorted(&l));
-  EXPECT_EQ(list_size(&l), std::size(origin));
+  skip_list_push_back(&l, 0);
+  skip_list_push_back(&l, 1);
+  skip_list_push_front(&l, 2);
+  skip_list_push_front(&l, 3);
+  skip_list_push_back(&l, 4);
+  skip_list_pop_front(&l);
+  skip_list_pop_back(&l);
 
-  for (int val : origin) {
-    EXPECT_NE(list_search(&l, val), std::size(origin));
-  }
+  EXPECT_TRUE(skip_list_equals(&l, expected, std::size(expected)));
 
-  list_destroy(&l);
+  skip_list_destroy(&l);
 }
 
-TEST(ListMergeSortTest, Sorted) {
-  static const int origin[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+TEST(SkipListTest, InsertRemoveStressed) {
+  struct skip_list l;
+  struct list ref;
+  skip_list_create(&l);
+  list_create(&ref);
 
-  struct list l;
-  list_create_from(&l, origin, std::size(origin));
+  for (int i = 0; i < 4 * BIG_SIZE; ++i) {
+    size_t index = (static_cast<size_t>(i) * 7919) % (list_size(&ref) + 1);
+    skip_list_insert(&l, i, index);
+    list_insert(&ref, i, index);
+  }
+  for (int i = 0; i < 3 * BIG_SIZE; ++i) {
+    size_t index = (static_cast<size_t>(i) * 104729) % list_size(&ref);
+    skip_list_remove(&l, index);
+    list_remove(&ref, index);
+  }
+  skip_list_set(&l, BIG_SIZE / 2, -1);
+  list_set(&ref, BIG_SIZE / 2, -1);
 
-  EXPECT_TRUE(list_is_sorted(&l));
+  ASSERT_EQ(skip_list_size(&l), list_size(&ref));
+  size_t i = 0;
+  for (struct list_node *curr = ref.first; curr != NULL; curr = curr->next) {
+    EXPECT_EQ(skip_list_get(&l, i++), curr->data);
+  }
 
-  list_merge_sort(&l);
+  skip_list_destroy(&l);
+  list_destroy(&ref);
+}
 
-  EXPECT_TRUE(list_is_sorted(&l));
-  EXPECT_EQ(list_size(&l), std::size(origin));
+TEST(SkipListTest, SearchSorted) {
+  struct skip_list l;
+  skip_list_create(&l);
 
-  for (int val : origin) {
-    EXPECT_NE(list_search(&l, val), std::size(origin));
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    skip_list_push_back(&l, 2 * (i / 2)); // Every value twice
   }
+  EXPECT_TRUE(skip_list_is_sorted(&l));
 
-  list_destroy(&l);
+  for (int i = 0; i < BIG_SIZE; i += 2) {
+    EXPECT_EQ(skip_list_search(&l, i), static_cast<size_t>(i));
+    EXPECT_EQ(skip_list_search(&l, i + 1), skip_list_size(&l));
+  }
+  EXPECT_EQ(skip_list_search(&l, -1), skip_list_size(&l));
+
+  skip_list_destroy(&l);
 }
 
 /*
@@ -1850,6 +3898,64 @@ TEST(TreeRemoveTest, Stressed) {
   tree_destroy(&t);
 }
 
+/*
+ * tree balancing
+ */
+
+// Check the AVL property and the stored heights, return the height
+static int check_avl(const struct tree_node *node) {
+  if (node == NULL) {
+    return 0;
+  }
+  int left = check_avl(node->left);
+  int right = check_avl(node->right);
+  EXPECT_LE(std::abs(left - right), 1);
+  EXPECT_EQ(node->height, std::max(left, right) + 1);
+  return node->height;
+}
+
+TEST(TreeBalanceTest, SortedInsert) {
+  struct tree t;
+  tree_create(&t);
+
+  for (int i = 0; i < 16 * BIG_SIZE; ++i) {
+    EXPECT_TRUE(tree_insert(&t, i));
+  }
+  check_avl(t.root);
+
+  // An AVL tree is at most 1.44 times higher than a perfect tree
+  size_t size = tree_size(&t);
+  EXPECT_EQ(size, static_cast<size_t>(16 * BIG_SIZE));
+  EXPECT_LE(tree_height(&t), 3 * log_2(size) / 2);
+
+  for (int i = 0; i < 16 * BIG_SIZE; ++i) {
+    EXPECT_TRUE(tree_contains(&t, i));
+  }
+
+  tree_destroy(&t);
+}
+
+TEST(TreeBalanceTest, Remove) {
+  struct tree t;
+  tree_create(&t);
+
+  for (int i = 16 * BIG_SIZE; i > 0; --i) {
+    tree_insert(&t, i);
+  }
+  for (int i = 1; i <= 16 * BIG_SIZE; i += 3) {
+    EXPECT_TRUE(tree_remove(&t, i));
+    EXPECT_FALSE(tree_remove(&t, i));
+  }
+  check_avl(t.root);
+
+  for (int i = 1; i <= 16 * BIG_SIZE; ++i) {
+    EXPECT_EQ(tree_contains(&t, i), i % 3 != 1);
+  }
+  EXPECT_LE(tree_height(&t), 3 * log_2(tree_size(&t)) / 2);
+
+  tree_destroy(&t);
+}
+
 /*
  * tree_walk_in_order
  */
@@ -1972,6 +4078,511 @@ TEST(TreeWalkPostOrderTest, Count) {
   tree_destroy(&t);
 }
 
+/*
+ * tree walks
+ */
+
+static void collect_tree(int value, void *user_data) {
+  static_cast<std::vector<int> *>(user_data)->push_back(value);
+}
+
+TEST(TreeWalkTest, Orders) {
+  struct tree t;
+  tree_create(&t);
+  for (int i = 1; i <= 7; ++i) {
+    tree_insert(&t, i); // Balanced with 4 at the root
+  }
+
+  std::vector<int> pre;
+  std::vector<int> in;
+  std::vector<int> post;
+  tree_walk_pre_order(&t, collect_tree, &pre);
+  tree_walk_in_order(&t, collect_tree, &in);
+  tree_walk_post_order(&t, collect_tree, &post);
+
+  EXPECT_EQ(pre, std::vector<int>({ 4, 6, 7, 5, 2, 3, 1 }));
+  EXPECT_EQ(in, std::vector<int>({ 1, 2, 3, 4, 5, 6, 7 }));
+  EXPECT_EQ(post, std::vector<int>({ 1, 3, 2, 5, 7, 6, 4 }));
+
+  tree_destroy(&t);
+}
+
+TEST(TreeWalkTest, Big) {
+  struct tree t;
+  tree_create(&t);
+  for (int i = 0; i < 64 * BIG_SIZE; ++i) {
+    tree_insert(&t, i);
+  }
+
+  std::vector<int> in;
+  tree_walk_in_order(&t, collect_tree, &in);
+  ASSERT_EQ(in.size(), static_cast<size_t>(64 * BIG_SIZE));
+  EXPECT_TRUE(std::is_sorted(in.begin(), in.end()));
+
+  std::vector<int> post;
+  tree_walk_post_order(&t, collect_tree, &post);
+  EXPECT_EQ(post.size(), in.size());
+  EXPECT_EQ(post.back(), t.root->data);
+
+  tree_destroy(&t);
+  EXPECT_TRUE(tree_empty(&t));
+}
+
+/*
+ * bptree
+ */
+
+TEST(BPTreeTest, InsertContains) {
+  static const int values[] = { 16, 2, 8, 4, 10, 18, 6, 12, 14 };
+
+  struct bptree t;
+  bptree_create(&t);
+  EXPECT_TRUE(bptree_empty(&t));
+  EXPECT_FALSE(bptree_contains(&t, 2));
+  EXPECT_FALSE(bptree_remove(&t, 2));
+
+  for (int val : values) {
+    EXPECT_TRUE(bptree_insert(&t, val));
+  }
+  EXPECT_FALSE(bptree_insert(&t, 8));
+  EXPECT_EQ(bptree_size(&t), std::size(values));
+
+  for (int i = 1; i <= 19; ++i) {
+    EXPECT_EQ(bptree_contains(&t, i), i % 2 == 0);
+  }
+
+  std::vector<int> in;
+  bptree_walk_in_order(&t, collect_tree, &in);
+  EXPECT_EQ(in, std::vector<int>({ 2, 4, 6, 8, 10, 12, 14, 16, 18 }));
+
+  bptree_destroy(&t);
+  EXPECT_TRUE(bptree_empty(&t));
+}
+
+TEST(BPTreeTest, SameAsTree) {
+  struct bptree b;
+  struct tree t;
+  bptree_create(&b);
+  tree_create(&t);
+
+  std::srand(0);
+  for (int i = 0; i < 64 * BIG_SIZE; ++i) {
+    int value = std::rand() % (16 * BIG_SIZE);
+    if (i % 3 == 2) {
+      EXPECT_EQ(bptree_remove(&b, value), tree_remove(&t, value));
+    } else {
+      EXPECT_EQ(bptree_insert(&b, value), tree_insert(&t, value));
+    }
+  }
+  EXPECT_EQ(bptree_size(&b), tree_size(&t));
+
+  std::vector<int> expected;
+  std::vector<int> in;
+  tree_walk_in_order(&t, collect_tree, &expected);
+  bptree_walk_in_order(&b, collect_tree, &in);
+  EXPECT_EQ(in, expected);
+
+  // Empty both trees
+  for (int val : expected) {
+    EXPECT_TRUE(bptree_remove(&b, val));
+  }
+  EXPECT_TRUE(bptree_empty(&b));
+  EXPECT_EQ(b.height, 0u);
+
+  bptree_destroy(&b);
+  tree_destroy(&t);
+}
+
+TEST(BPTreeTest, Memory) {
+  counting_allocator_stats stats;
+  struct allocator allocator = { counting_allocate, counting_reallocate, counting_deallocate, &stats };
+
+  struct bptree b;
+  bptree_create_with(&b, &allocator);
+  for (int i = 0; i < 64 * BIG_SIZE; ++i) {
+    bptree_insert(&b, i);
+  }
+
+  // Less than half full leaves would still use less memory than the tree nodes
+  EXPECT_LT(stats.allocated, 64 * BIG_SIZE * sizeof(struct tree_node) / 2);
+
+  for (int i = 0; i < 64 * BIG_SIZE; i += 2) {
+    EXPECT_TRUE(bptree_remove(&b, i));
+  }
+  for (int i = 0; i < 64 * BIG_SIZE; ++i) {
+    EXPECT_EQ(bptree_contains(&b, i), i % 2 == 1);
+  }
+
+  bptree_destroy(&b);
+  EXPECT_EQ(stats.allocated, 0u);
+}
+
+// Allocates up to budget blocks, then fails
+struct limited_allocator_stats {
+  counting_allocator_stats counting;
+  std::size_t budget = 0;
+};
+
+static void *limited_allocate(void *ctx, std::size_t size) {
+  auto stats = static_cast<limited_allocator_stats *>(ctx);
+  if (stats->budget == 0) {
+    return nullptr;
+  }
+  stats->budget--;
+  return counting_allocate(&stats->counting, size);
+}
+
+static void limited_deallocate(void *ctx, void *ptr, std::size_t size) {
+  auto stats = static_cast<limited_allocator_stats *>(ctx);
+  counting_deallocate(&stats->counting, ptr, size);
+}
+
+TEST(BPTreeTest, AllocationFailure) {
+  limited_allocator_stats stats;
+  struct allocator allocator = { limited_allocate, nullptr, limited_deallocate, &stats };
+
+  struct bptree b;
+  bptree_create_with(&b, &allocator);
+
+  // Grant a few more nodes each round and fill until an insert fails, nothing must be lost
+  std::size_t budgets[] = { 1, 2, 40 };
+  int next = 0;
+  for (std::size_t budget : budgets) {
+    stats.budget = budget;
+    while (bptree_insert(&b, next)) {
+      ++next;
+    }
+    EXPECT_EQ(bptree_size(&b), static_cast<std::size_t>(next));
+    for (int i = 0; i <= next; ++i) {
+      EXPECT_EQ(bptree_contains(&b, i), i < next);
+    }
+    int count = 0;
+    bptree_walk_in_order(&b, [](int, void *user_data) { ++*static_cast<int *>(user_data); }, &count);
+    EXPECT_EQ(count, next);
+  }
+
+  stats.budget = SIZE_MAX;
+  EXPECT_TRUE(bptree_insert(&b, next));
+  EXPECT_TRUE(bptree_contains(&b, next));
+
+  bptree_destroy(&b);
+  EXPECT_EQ(stats.counting.allocated, 0u);
+}
+
+TEST(BPTreeTest, WalkRange) {
+  struct bptree b;
+  bptree_create(&b);
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    bptree_insert(&b, 3 * i);
+  }
+
+  std::vector<int> range;
+  bptree_walk_range(&b, 100, 200, collect_tree, &range);
+  ASSERT_EQ(range.size(), 33u);
+  EXPECT_EQ(range.front(), 102);
+  EXPECT_EQ(range.back(), 198);
+
+  range.clear();
+  bptree_walk_range(&b, 3 * BIG_SIZE - 3, INT_MAX, collect_tree, &range);
+  EXPECT_EQ(range, std::vector<int>({ 3 * BIG_SIZE - 3 }));
+
+  range.clear();
+  bptree_walk_range(&b, 200, 100, collect_tree, &range);
+  EXPECT_TRUE(range.empty());
+
+  bptree_destroy(&b);
+}
+
+/*
+ * algo::array
+ */
+
+TEST(TemplateArrayTest, SameAsC) {
+  struct array a;
+  algo::int_array b;
+  array_create(&a);
+
+  std::srand(0);
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    int value = std::rand() % BIG_SIZE;
+    array_push_back(&a, value);
+    b.push_back(value);
+  }
+
+  array_insert(&a, 42, 10);
+  b.insert(42, 10);
+  array_remove_range(&a, 100, 50);
+  b.remove_range(100, 50);
+
+  EXPECT_TRUE(b.equals(a.data, a.size));
+  EXPECT_EQ(b.search(42), array_search(&a, 42));
+
+  array_quick_sort(&a);
+  b.quick_sort();
+
+  EXPECT_TRUE(b.is_sorted());
+  EXPECT_TRUE(b.equals(a.data, a.size));
+
+  for (int value = 0; value < BIG_SIZE; ++value) {
+    EXPECT_EQ(b.search_sorted(value), array_search_sorted(&a, value));
+  }
+
+  array_destroy(&a);
+}
+
+TEST(TemplateArrayTest, LongKeys) {
+  algo::array<long long> a;
+
+  for (long long i = 0; i < BIG_SIZE; ++i) {
+    a.push_back((BIG_SIZE - i) << 33);
+  }
+
+  a.heap_sort();
+
+  EXPECT_TRUE(a.is_sorted());
+  EXPECT_EQ(a[0], 1LL << 33);
+  EXPECT_EQ(a.search_sorted(static_cast<long long>(BIG_SIZE) << 33), static_cast<std::size_t>(BIG_SIZE - 1));
+}
+
+struct record {
+  int key;
+  int payload;
+
+  bool operator==(const record &other) const {
+    return key == other.key && payload == other.payload;
+  }
+};
+
+struct record_key_greater {
+  bool operator()(const record &a, const record &b) const {
+    return a.key > b.key;
+  }
+};
+
+TEST(TemplateArrayTest, RecordsWithComparator) {
+  algo::array<record, record_key_greater> a;
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    a.push_back(record{ i, -i });
+  }
+
+  a.quick_sort();
+
+  EXPECT_TRUE(a.is_sorted());
+  EXPECT_EQ(a[0].key, BIG_SIZE - 1);
+  EXPECT_EQ(a[0].payload, 1 - BIG_SIZE);
+}
+
+TEST(TemplateArrayTest, NotTriviallyCopyable) {
+  static const std::string origin[] = { "c", "a", "d", "b" };
+  static const std::string expected[] = { "a", "b", "c", "d", "e" };
+
+  algo::array<std::string> a(origin, std::size(origin));
+  a.push_back("e");
+  a.insert("x", 2);
+  a.remove(2);
+  a.quick_sort();
+
+  EXPECT_TRUE(a.equals(expected, std::size(expected)));
+
+  algo::array<std::string> b = a;
+  b.remove_range(0, 2);
+  b.shrink_to_fit();
+
+  EXPECT_EQ(b.size(), 3u);
+  EXPECT_EQ(b[0], "c");
+  EXPECT_EQ(a.size(), std::size(expected));
+}
+
+TEST(TemplateArrayTest, Heap) {
+  algo::array<int, std::less<int>, 4> a;
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    a.heap_add(i);
+    EXPECT_EQ(a.heap_top(), i);
+    EXPECT_TRUE(a.is_heap());
+  }
+
+  for (int i = BIG_SIZE - 1; i >= 0; --i) {
+    EXPECT_EQ(a.heap_top(), i);
+    a.heap_remove_top();
+    EXPECT_TRUE(a.is_heap());
+  }
+
+  EXPECT_TRUE(a.empty());
+}
+
+TEST(TemplateArrayTest, PushOwnElement) {
+  algo::array<int> a;
+  a.push_back(1);
+
+  // The buffer is full each time, the referenced element moves while growing
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    a.push_back(a[a.size() - 1]);
+  }
+  a.heap_add(a[0]);
+
+  EXPECT_EQ(a.size(), static_cast<std::size_t>(BIG_SIZE + 2));
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    EXPECT_EQ(a[i], 1);
+  }
+}
+
+TEST(TemplateArrayTest, CopyKeepsGrowthFactor) {
+  static const int origin[] = { 1, 2, 3, 4 };
+
+  algo::int_array a;
+  a.set_growth_factor(4.0);
+  a.append_range(origin, std::size(origin));
+
+  algo::int_array b(a);
+  EXPECT_EQ(b.capacity(), std::size(origin));
+  b.push_back(5);
+  EXPECT_EQ(b.capacity(), 4 * std::size(origin));
+}
+
+TEST(TemplateArrayTest, InvalidGrowthFactor) {
+  static const int origin[] = { 1, 2, 3, 4 };
+
+  algo::int_array a;
+  a.append_range(origin, std::size(origin));
+  a.set_growth_factor(std::nan(""));
+  a.set_growth_factor(INFINITY);
+  a.push_back(5);
+  EXPECT_EQ(a.capacity(), 2 * std::size(origin));
+}
+
+/*
+ * algo::list
+ */
+
+TEST(TemplateListTest, Edit) {
+  static const int origin[] = { 1, 2, 3, 4 };
+  static const int expected[] = { 0, 1, 3, 4, 5 };
+
+  algo::int_list l(origin, std::size(origin));
+  l.push_front(0);
+  l.push_back(5);
+  l.insert(42, 3);
+  l.remove(3);
+  l.remove(2);
+
+  EXPECT_TRUE(l.equals(expected, std::size(expected)));
+  EXPECT_EQ(l.search(3), 2u);
+  EXPECT_EQ(*l.get(4), 5);
+  EXPECT_EQ(l.get(5), nullptr);
+}
+
+TEST(TemplateListTest, MergeSort) {
+  algo::list<long long> l;
+
+  std::srand(0);
+
+  for (int i = 0; i < BIG_SIZE + 3; ++i) {
+    l.push_back(std::rand() % BIG_SIZE);
+  }
+
+  l.merge_sort();
+
+  EXPECT_TRUE(l.is_sorted());
+  EXPECT_EQ(l.size(), static_cast<std::size_t>(BIG_SIZE + 3));
+
+  // The prev links are correct
+  std::size_t count = 0;
+  for (auto *curr = l.last(); curr != nullptr; curr = curr->prev) {
+    ++count;
+  }
+  EXPECT_EQ(count, l.size());
+}
+
+/*
+ * algo::tree
+ */
+
+TEST(TemplateTreeTest, SameAsC) {
+  struct tree t;
+  algo::int_tree u;
+  tree_create(&t);
+
+  std::srand(0);
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    int value = std::rand() % BIG_SIZE;
+    EXPECT_EQ(u.insert(value), tree_insert(&t, value));
+  }
+
+  for (int i = 0; i < BIG_SIZE; ++i) {
+    int value = std::rand() % BIG_SIZE;
+    EXPECT_EQ(u.remove(value), tree_remove(&t, value));
+  }
+
+  EXPECT_EQ(u.size(), tree_size(&t));
+
+  for (int value = 0; value < BIG_SIZE; ++value) {
+    EXPECT_EQ(u.contains(value), tree_contains(&t, value));
+  }
+
+  int previous = -1;
+  u.walk_in_order([&previous](int value) {
+    EXPECT_LT(previous, value);
+    previous = value;
+  });
+
+  tree_destroy(&t);
+}
+
+TEST(TemplateTreeTest, Walks) {
+  algo::tree<long long> t;
+
+  t.insert(2);
+  t.insert(1);
+  t.insert(3);
+
+  long long pre[3];
+  long long post[3];
+  std::size_t i = 0;
+  std::size_t j = 0;
+
+  t.walk_pre_order([&](long long value) { pre[i++] = value; });
+  t.walk_post_order([&](long long value) { post[j++] = value; });
+
+  EXPECT_EQ(pre[0], 2);
+  EXPECT_EQ(post[2], 2);
+  EXPECT_EQ(t.height(), 2u);
+}
+
+TEST(TemplateTreeTest, SameShapeAsC) {
+  struct tree t;
+  algo::int_tree u;
+  tree_create(&t);
+
+  // Sorted keys, the trees stay balanced
+  for (int i = 0; i < 16 * BIG_SIZE; ++i) {
+    u.insert(i);
+    tree_insert(&t, i);
+  }
+  for (int i = 0; i < 16 * BIG_SIZE; i += 3) {
+    EXPECT_EQ(u.remove(i), tree_remove(&t, i));
+  }
+  EXPECT_EQ(u.height(), tree_height(&t));
+  EXPECT_EQ(u.size(), tree_size(&t));
+
+  std::vector<int> expected;
+  std::vector<int> pre;
+  std::vector<int> post;
+  tree_walk_pre_order(&t, collect_tree, &expected);
+  u.walk_pre_order([&pre](int value) { pre.push_back(value); });
+  EXPECT_EQ(pre, expected);
+
+  expected.clear();
+  tree_walk_post_order(&t, collect_tree, &expected);
+  u.walk_post_order([&post](int value) { post.push_back(value); });
+  EXPECT_EQ(post, expected);
+
+  tree_destroy(&t);
+}
+
 int main(int argc, char *argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();